@@ -0,0 +1,10 @@
+find_path(zstd_INCLUDE_DIRS zstd.h)
+
+find_library(zstd_LIBRARIES zstd)
+
+#TODO check version
+
+find_package(PackageHandleStandardArgs REQUIRED)
+find_package_handle_standard_args(zstd
+  REQUIRED_VARS zstd_INCLUDE_DIRS zstd_LIBRARIES
+  )
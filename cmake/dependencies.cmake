@@ -407,4 +407,38 @@ set_target_properties(LMDB PROPERTIES
 
 if(NOT LMDB_FOUND)
   add_dependencies(LMDB lmdb_LMDB)
-endif()
\ No newline at end of file
+endif()
+
+
+###########################
+#         zstd            #
+###########################
+find_package(zstd)
+
+if(NOT zstd_FOUND)
+  ExternalProject_Add(facebook_zstd
+    GIT_REPOSITORY    "https://github.com/facebook/zstd.git"
+    GIT_TAG           "v1.3.0"
+    CONFIGURE_COMMAND ""
+    BUILD_IN_SOURCE   1
+    BUILD_COMMAND     cd lib && $(MAKE) libzstd.a CC="${CMAKE_C_COMPILER}" "CFLAGS=-fPIC -O3"
+    INSTALL_COMMAND   "" # remove install step
+    TEST_COMMAND      "" # remove test step
+    UPDATE_COMMAND    "" # remove update step
+    )
+  ExternalProject_Get_Property(facebook_zstd source_dir)
+  set(zstd_INCLUDE_DIRS ${source_dir}/lib)
+  set(zstd_LIBRARIES ${source_dir}/lib/libzstd.a)
+  file(MAKE_DIRECTORY ${zstd_INCLUDE_DIRS})
+endif()
+
+add_library(zstd STATIC IMPORTED)
+set_target_properties(zstd PROPERTIES
+  INTERFACE_INCLUDE_DIRECTORIES "${zstd_INCLUDE_DIRS};${zstd_INCLUDE_DIRS}/dictBuilder"
+  IMPORTED_LOCATION ${zstd_LIBRARIES}
+  IMPORTED_LINK_INTERFACE_LANGUAGES "C"
+  )
+
+if(NOT zstd_FOUND)
+  add_dependencies(zstd facebook_zstd)
+endif()
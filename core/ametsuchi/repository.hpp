@@ -19,12 +19,18 @@
 #define IROHA_REPOSITORY_H
 
 #include <main_generated.h>
+#include <cstdint>
+#include <memory>
 
 namespace repository {
 void init();
 
 void append(const iroha::Transaction& tx);
 
+// Make appended transactions durable, or drop them
+void commit();
+void rollback();
+
 std::vector<const iroha::Asset*> findAssetByPublicKey(
     const flatbuffers::String& key);
 
@@ -34,7 +40,28 @@ bool checkUserCanPermission(const flatbuffers::String& key);
 
 const std::string getMerkleRoot();
 
-const ::iroha::Transaction* getTransaction(size_t index);
+// Merkle root after transaction index, empty if it is unknown
+const std::string getMerkleRoot(size_t index);
+
+// Index of the last committed transaction
+size_t getHeight();
+
+// Consensus order of the last decided event, committed with the next commit()
+void setOrder(std::uint64_t order);
+
+// Consensus order of the last committed decision, 0 if there is none
+std::uint64_t getOrder();
+
+// Replace database with snapshot downloaded from another peer, returns true
+// if merkle root of the installed database is root
+bool installSnapshot(const std::string& snapshot_folder,
+                     const std::string& root);
+
+// Keeps the transaction alive, while the pointer is held
+std::shared_ptr<const ::iroha::Transaction> getTransaction(size_t index);
+
+// Data of attachment stored out of line, empty if there is no such digest
+std::vector<uint8_t> getAttachment(const flatbuffers::Vector<uint8_t>& digest);
 
 namespace front_repository {
 void initialize_repository();
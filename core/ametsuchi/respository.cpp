@@ -25,11 +25,15 @@
 #include <service/connection.hpp>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <sys/stat.h>
 
 namespace repository {
 
 static std::unique_ptr<ametsuchi::Ametsuchi> db;
+// installSnapshot replaces db, every other use holds the lock shared
+static std::shared_timed_mutex db_mutex;
 const std::string folder = "/tmp/ametsuchi/";
 
 void init() {
@@ -49,16 +53,55 @@ void init() {
 }
 
 void append(const iroha::Transaction &tx) {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
+  auto attachment = tx.attachment();
+  if (attachment != nullptr && attachment->data() != nullptr &&
+      attachment->data()->size() > AMETSUCHI_ATTACHMENT_THRESHOLD) {
+    // large attachment is stored once in blob store, transaction keeps digest
+    auto digest = db->putAttachment(std::vector<uint8_t>(
+        attachment->data()->begin(), attachment->data()->end()));
+    auto buf = flatbuffer_service::transaction::GetDetachedTxPointer(
+        tx, std::vector<uint8_t>(digest.begin(), digest.end()));
+    db->append(&buf.value());
+    return;
+  }
   auto buf = flatbuffer_service::transaction::GetTxPointer(tx);
   db->append(&buf.value());
 }
 
-const ::iroha::Transaction *getTransaction(size_t index) {
+void commit() {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
+  db->commit();
+}
+
+void rollback() {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
+  db->rollback();
+}
+
+std::shared_ptr<const ::iroha::Transaction> getTransaction(size_t index) {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
   return db->getTransaction(index, false);
 }
 
+std::vector<uint8_t> getAttachment(const flatbuffers::Vector<uint8_t> &digest) {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
+  ametsuchi::merkle::hash_t h;
+  if (digest.size() != h.size()) {
+    return {};
+  }
+  std::copy(digest.begin(), digest.end(), h.begin());
+  auto blob = db->getAttachment(h);
+  if (blob.data == nullptr) {
+    return {};
+  }
+  auto ptr = static_cast<const uint8_t *>(blob.data);
+  return std::vector<uint8_t>(ptr, ptr + blob.size);
+}
+
 std::vector<const iroha::Asset *> findAssetByPublicKey(
     const flatbuffers::String &key) {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
   flatbuffers::FlatBufferBuilder fbb;
   return db->accountGetAllAssets(&key);
 }
@@ -71,22 +114,58 @@ bool checkUserCanPermission(const flatbuffers::String &key) {
   return false;
 }
 
-const std::string getMerkleRoot() { return db->getMerkleRoot(); }
+const std::string getMerkleRoot() {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
+  return db->getMerkleRoot();
+}
+
+const std::string getMerkleRoot(size_t index) {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
+  return db->getMerkleRoot(index);
+}
+
+size_t getHeight() {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
+  return db->height();
+}
+
+void setOrder(std::uint64_t order) {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
+  db->setOrder(order);
+}
+
+std::uint64_t getOrder() {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
+  return db->order();
+}
+
+bool installSnapshot(const std::string &snapshot_folder,
+                     const std::string &root) {
+  // waits for queries, commits and snapshot exports in progress
+  std::unique_lock<std::shared_timed_mutex> lock(db_mutex);
+  db.reset();
+  ametsuchi::Ametsuchi::installSnapshot(snapshot_folder, folder);
+  db = std::make_unique<ametsuchi::Ametsuchi>(folder);
+  return db->getMerkleRoot() == root;
+}
 
 namespace permission {
 
 std::vector<const iroha::AccountPermissionLedger *> getPermissionLedgerOf(
     const flatbuffers::String &key) {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
   return db->assetGetPermissionLedger(&key);
 }
 
 std::vector<const iroha::AccountPermissionDomain *> getPermissionDomainOf(
     const flatbuffers::String &key) {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
   return db->assetGetPermissionDomain(&key);
 }
 
 std::vector<const iroha::AccountPermissionAsset *> getPermissionAssetOf(
     const flatbuffers::String &key) {
+  std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
   return db->assetGetPermissionAsset(&key);
 }
 }
@@ -95,6 +174,7 @@ void initialize_repository() {
   connection::iroha::AssetRepositoryImpl::AccountGetAsset::receive(
       [=](const std::string & /* from */, flatbuffers::unique_ptr_t &&query_ptr)
           -> std::vector<const ::iroha::Asset *> {
+        std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
         const iroha::AssetQuery &query =
             *flatbuffers::GetRoot<iroha::AssetQuery>(query_ptr.get());
         auto ln = query.ledger_name();
@@ -103,11 +183,59 @@ void initialize_repository() {
         if (ln == nullptr || dn == nullptr || an == nullptr) {
           return db->accountGetAllAssets(query.pubKey(), query.uncommitted());
         } else {
-          std::vector<const ::iroha::Asset *> res{db->accountGetAsset(
-              query.pubKey(), ln, dn, an, query.uncommitted())};
+          std::vector<const ::iroha::Asset *> res;
+          auto asset = db->accountGetAsset(query.pubKey(), ln, dn, an,
+                                           query.uncommitted());
+          if (asset != nullptr) res.push_back(asset);
           return res;
         }
     });
+
+  connection::iroha::AssetRepositoryImpl::AssetGetStats::receive(
+      [=](const std::string & /* from */, flatbuffers::unique_ptr_t &&query_ptr)
+          -> connection::iroha::AssetRepositoryImpl::AssetGetStats::Stats {
+        std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
+        const iroha::AssetQuery &query =
+            *flatbuffers::GetRoot<iroha::AssetQuery>(query_ptr.get());
+        auto stats = db->assetGetStats(
+            query.ledger_name()->str(), query.domain_name()->str(),
+            query.asset_name()->str(), query.uncommitted());
+        ametsuchi::Currency supply(stats.total_supply, stats.precision);
+        return {supply.to_string(), stats.holders, stats.precision};
+    });
+
+  connection::memberShipService::SyncImpl::fetchSnapshot::receive(
+      [=](const std::string & /* from */, flatbuffers::unique_ptr_t && /* ping */)
+          -> connection::memberShipService::SyncImpl::fetchSnapshot::Snapshot {
+        std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
+        // the latest snapshot is reused until the next transaction
+        static std::mutex snapshot_mutex;
+        static connection::memberShipService::SyncImpl::fetchSnapshot::Snapshot
+            snapshot{"", 0, ""};
+        std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex);
+        if (snapshot.folder.empty() || snapshot.height != db->height()) {
+          auto path = folder.substr(0, folder.size() - 1) + "_snapshot_" +
+                      std::to_string(db->height()) + "/";
+          auto info = db->exportSnapshot(path);
+          if (!snapshot.folder.empty() && snapshot.folder != path) {
+            ametsuchi::remove_folder(snapshot.folder);
+          }
+          snapshot = {path, info.height,
+                      std::string(info.root.begin(), info.root.end())};
+        }
+        return snapshot;
+    });
+
+  connection::memberShipService::SyncImpl::getTransactions::receive(
+      [=](const std::string & /* from */, flatbuffers::unique_ptr_t &&ping_ptr)
+          -> std::vector<std::shared_ptr<const ::iroha::Transaction>> {
+        std::shared_lock<std::shared_timed_mutex> lock(db_mutex);
+        const iroha::Ping &ping =
+            *flatbuffers::GetRoot<iroha::Ping>(ping_ptr.get());
+        size_t index = std::stoul(ping.message()->str());
+        if (index == 0 || index > db->height()) return {};
+        return {db->getTransaction(index)};
+    });
   }
 
     bool existAccountOf(const flatbuffers::String &key) {
@@ -161,16 +289,18 @@ void initialize_repository() {
                 if(ln == nullptr || dn == nullptr || an == nullptr) {
                     return db->accountGetAllAssets(query.pubKey(), query.uncommitted());
                 }else{
-                    std::vector<const ::iroha::Asset *> res{db->accountGetAsset(query.pubKey(), ln, dn, an, query.uncommitted())};
+                    std::vector<const ::iroha::Asset *> res;
+                    auto asset = db->accountGetAsset(query.pubKey(), ln, dn, an, query.uncommitted());
+                    if (asset != nullptr) res.push_back(asset);
                     return res;
                 }
             });
 
             connection::memberShipService::SyncImpl::getTransactions::receive([=](
-                    const std::string & /* from */, flatbuffers::unique_ptr_t &&query_ptr) -> std::vector<const ::iroha::Transaction*>{
+                    const std::string & /* from */, flatbuffers::unique_ptr_t &&query_ptr) -> std::vector<std::shared_ptr<const ::iroha::Transaction>>{
                 if(db == nullptr) init();
                 const iroha::Ping& ping = *flatbuffers::GetRoot<iroha::Ping>(query_ptr.get());
-                std::vector<const ::iroha::Transaction*> ret;
+                std::vector<std::shared_ptr<const ::iroha::Transaction>> ret;
                 size_t index = stoi(ping.message()->str());
                 ret.emplace_back( db->getTransaction(index) );
                 return ret;
@@ -0,0 +1,79 @@
+/*
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mempool.hpp"
+
+namespace sumeragi {
+
+Mempool::Mempool(size_t max_size, size_t max_bytes, size_t max_per_creator)
+    : max_size_(max_size),
+      max_bytes_(max_bytes),
+      max_per_creator_(max_per_creator) {}
+
+Mempool::Admission Mempool::add(const std::string& key,
+                                const std::string& creator,
+                                std::vector<std::uint8_t>&& tx) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (keys_.count(key) != 0) {
+    stats_.duplicates++;
+    return Admission::DUPLICATE;
+  }
+
+  auto it = queues_.find(creator);
+  const size_t queued = it == queues_.end() ? 0 : it->second.size();
+  if (stats_.size >= max_size_ || stats_.bytes + tx.size() > max_bytes_ ||
+      queued >= max_per_creator_) {
+    stats_.rejected++;
+    return Admission::BUSY;
+  }
+
+  if (queued == 0) {
+    creators_.push_back(creator);
+  }
+  stats_.size++;
+  stats_.bytes += tx.size();
+  stats_.accepted++;
+  keys_.insert(key);
+  queues_[creator].push_back(Entry{key, std::move(tx)});
+  return Admission::ACCEPTED;
+}
+
+bool Mempool::pop(std::vector<std::uint8_t>& tx) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (creators_.empty()) return false;
+
+  auto creator = std::move(creators_.front());
+  creators_.pop_front();
+  auto it = queues_.find(creator);
+  auto& queue = it->second;
+
+  tx = std::move(queue.front().tx);
+  keys_.erase(queue.front().key);
+  queue.pop_front();
+  stats_.size--;
+  stats_.bytes -= tx.size();
+
+  if (queue.empty()) {
+    queues_.erase(it);
+  } else {
+    creators_.push_back(std::move(creator));
+  }
+  return true;
+}
+
+Mempool::Stats Mempool::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+}  // namespace sumeragi
@@ -0,0 +1,82 @@
+/*
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CORE_CONSENSUS_MEMPOOL_HPP_
+#define CORE_CONSENSUS_MEMPOOL_HPP_
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace sumeragi {
+
+/*
+ * Mempool keeps transactions received by Torii until consensus takes them.
+ *  - bounded by number of transactions, their bytes, and transactions of one
+ *    creator, a transaction over the bounds is not admitted (BUSY), so the
+ *    client may retry later instead of waiting for a dropped one
+ *  - transactions are deduplicated by key (hash)
+ *  - pop() takes creators in turn, so one busy creator does not delay others
+ */
+class Mempool {
+ public:
+  enum class Admission {
+    ACCEPTED,
+    DUPLICATE,  // same key is in the mempool already
+    BUSY,       // mempool, or creator's share of it, is full
+  };
+
+  struct Stats {
+    size_t size;
+    size_t bytes;
+    std::uint64_t accepted;
+    std::uint64_t duplicates;
+    std::uint64_t rejected;  // BUSY
+  };
+
+  Mempool(size_t max_size, size_t max_bytes, size_t max_per_creator);
+
+  Admission add(const std::string& key, const std::string& creator,
+                std::vector<std::uint8_t>&& tx);
+
+  // take the next transaction, returns false if mempool is empty
+  bool pop(std::vector<std::uint8_t>& tx);
+
+  Stats stats() const;
+
+ private:
+  struct Entry {
+    std::string key;
+    std::vector<std::uint8_t> tx;
+  };
+
+  const size_t max_size_;
+  const size_t max_bytes_;
+  const size_t max_per_creator_;
+
+  mutable std::mutex mutex_;
+  // creator => its transactions in FIFO order
+  std::unordered_map<std::string, std::deque<Entry>> queues_;
+  // creators with transactions, the next one to pop() first
+  std::deque<std::string> creators_;
+  std::unordered_set<std::string> keys_;
+  Stats stats_{};
+};
+
+}  // namespace sumeragi
+
+#endif  // CORE_CONSENSUS_MEMPOOL_HPP_
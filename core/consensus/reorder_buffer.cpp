@@ -0,0 +1,60 @@
+/*
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "reorder_buffer.hpp"
+
+namespace sumeragi {
+
+ReorderBuffer::ReorderBuffer(std::uint64_t next, size_t history)
+    : next_(next), history_(history) {}
+
+void ReorderBuffer::reset(std::uint64_t next, size_t history) {
+  next_ = next;
+  history_ = history;
+  held_.clear();
+  decided_.clear();
+}
+
+bool ReorderBuffer::push(std::uint64_t order,
+                         flatbuffers::unique_ptr_t&& event) {
+  if (order < next_) return false;
+  return held_.emplace(order, std::move(event)).second;
+}
+
+size_t ReorderBuffer::drain(const Apply& apply) {
+  size_t applied = 0;
+  while (!held_.empty() && held_.begin()->first == next_) {
+    auto event =
+        std::make_shared<flatbuffers::unique_ptr_t>(std::move(held_.begin()->second));
+    try {
+      apply(next_, event);
+    } catch (...) {
+      held_.begin()->second = std::move(*event);
+      throw;
+    }
+    held_.erase(held_.begin());
+    decided_.emplace(next_++, std::move(event));
+    applied++;
+  }
+  while (decided_.size() > history_) {
+    decided_.erase(decided_.begin());
+  }
+  return applied;
+}
+
+ReorderBuffer::Event ReorderBuffer::decided(std::uint64_t order) const {
+  auto it = decided_.find(order);
+  return it == decided_.end() ? nullptr : it->second;
+}
+
+}  // namespace sumeragi
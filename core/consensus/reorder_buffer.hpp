@@ -0,0 +1,74 @@
+/*
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CORE_CONSENSUS_REORDER_BUFFER_HPP_
+#define CORE_CONSENSUS_REORDER_BUFFER_HPP_
+
+#include <flatbuffers/flatbuffers.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+
+namespace sumeragi {
+
+/*
+ * ReorderBuffer holds committed events, which arrive ahead of their order,
+ * and applies them strictly by order. The last applied ones are kept for
+ * peers, which missed them.
+ * Not thread-safe, Sumeragi uses it under pipeline.mutex.
+ */
+class ReorderBuffer {
+ public:
+  using Event = std::shared_ptr<flatbuffers::unique_ptr_t>;
+  using Apply = std::function<void(std::uint64_t order, const Event& event)>;
+
+  explicit ReorderBuffer(std::uint64_t next = 1, size_t history = 1024);
+
+  // orders before next are applied already, at most history of applied
+  // events are kept
+  void reset(std::uint64_t next, size_t history);
+
+  // hold committed event of order, returns false if the order is applied
+  // already or its event is held
+  bool push(std::uint64_t order, flatbuffers::unique_ptr_t&& event);
+
+  /*
+   * Apply held events from next() while their orders follow each other.
+   * If apply throws, its event stays held and next() is not advanced, so
+   * the order is applied by a later drain(); the exception is passed on.
+   * Returns number of applied events.
+   */
+  size_t drain(const Apply& apply);
+
+  // order of the next event to apply
+  std::uint64_t next() const { return next_; }
+
+  // no event is held ahead of next()
+  bool empty() const { return held_.empty(); }
+
+  // applied event of order, nullptr if it is not kept (or not applied)
+  Event decided(std::uint64_t order) const;
+
+ private:
+  std::uint64_t next_;
+  size_t history_;
+  // order => committed event, received ahead of next_
+  std::map<std::uint64_t, flatbuffers::unique_ptr_t> held_;
+  // order => applied event
+  std::map<std::uint64_t, Event> decided_;
+};
+
+}  // namespace sumeragi
+
+#endif  // CORE_CONSENSUS_REORDER_BUFFER_HPP_
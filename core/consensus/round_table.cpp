@@ -0,0 +1,48 @@
+/*
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "round_table.hpp"
+#include <algorithm>
+
+namespace sumeragi {
+
+RoundTable::RoundTable(size_t shards) {
+  for (size_t i = 0; i < std::max<size_t>(shards, 1); i++) {
+    shards_.emplace_back(new Shard());
+  }
+}
+
+bool RoundTable::erase(const std::string& key, RoundState* state) {
+  auto& shard = shard_of(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.rounds.find(key);
+  if (it == shard.rounds.end()) return false;
+  if (state != nullptr) *state = std::move(it->second);
+  shard.rounds.erase(it);
+  return true;
+}
+
+size_t RoundTable::size() const {
+  size_t total = 0;
+  for (auto&& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    total += shard->rounds.size();
+  }
+  return total;
+}
+
+RoundTable::Shard& RoundTable::shard_of(const std::string& key) {
+  return *shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+}  // namespace sumeragi
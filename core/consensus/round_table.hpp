@@ -0,0 +1,105 @@
+/*
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *          http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CORE_CONSENSUS_ROUND_TABLE_HPP_
+#define CORE_CONSENSUS_ROUND_TABLE_HPP_
+
+#include <flatbuffers/flatbuffers.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sumeragi {
+
+enum class RoundPhase {
+  SIGNING,    // collecting signatures
+  COMMITTED,  // 2f+1 signatures, commit is sent
+};
+
+// state of one in-flight consensus round
+struct RoundState {
+  RoundPhase phase = RoundPhase::SIGNING;
+  std::set<std::string> signers;  // public keys of collected signatures
+  std::chrono::steady_clock::time_point start;
+  // received copies with new signatures, waiting to be merged and processed
+  std::vector<flatbuffers::unique_ptr_t> pending;
+  bool scheduled = false;  // a worker processes the round
+  bool armed = false;      // panic() timeout of the round is set
+};
+
+/*
+ * RoundTable holds state of in-flight rounds keyed by event key.
+ * The table is split into shards with their own locks, so rounds of
+ * different events are updated in parallel.
+ */
+class RoundTable {
+ public:
+  explicit RoundTable(size_t shards = 16);
+
+  /*
+   * Run f on state of round key under its shard's lock, round is created
+   * (started now) if there is no such round. Returns result of f.
+   * f must not access the table.
+   */
+  template <typename F>
+  auto update(const std::string& key, F&& f)
+      -> decltype(f(std::declval<RoundState&>())) {
+    auto& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.rounds.find(key);
+    if (it == shard.rounds.end()) {
+      it = shard.rounds.emplace(key, RoundState()).first;
+      it->second.start = std::chrono::steady_clock::now();
+    }
+    return f(it->second);
+  }
+
+  /*
+   * Run f on state of round key under its shard's lock, if there is such
+   * round. Returns false if there is not.
+   * f must not access the table.
+   */
+  template <typename F>
+  bool visit(const std::string& key, F&& f) {
+    auto& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.rounds.find(key);
+    if (it == shard.rounds.end()) return false;
+    f(it->second);
+    return true;
+  }
+
+  // remove round, its state is moved to state if it is not null
+  bool erase(const std::string& key, RoundState* state = nullptr);
+
+  // number of rounds in every shard
+  size_t size() const;
+
+ private:
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, RoundState> rounds;
+  };
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  Shard& shard_of(const std::string& key);
+};
+
+}  // namespace sumeragi
+
+#endif  // CORE_CONSENSUS_ROUND_TABLE_HPP_
@@ -19,22 +19,34 @@
 #include <infra/config/peer_service_with_json.hpp>
 #include <membership_service/peer_service.hpp>
 #include <thread_pool.hpp>
+#include <utils/digest_set.hpp>
 #include <utils/explore.hpp>
 #include <utils/logger.hpp>
-#include <utils/timer.hpp>
+#include <utils/priority_task_queue.hpp>
+#include <utils/latency_tracker.hpp>
+#include <utils/timeout_queue.hpp>
 #include <runtime/runtime.hpp>
 
 #include <main_generated.h>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cmath>
 #include <deque>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <ametsuchi/repository.hpp>
 #include <service/connection.hpp>
+#include "mempool.hpp"
+#include "reorder_buffer.hpp"
+#include "round_table.hpp"
 #include "sumeragi.hpp"
 
 /**
@@ -56,7 +68,9 @@ namespace sumeragi {
     using iroha::Signature;
     using iroha::Transaction;
 
-    std::map<std::string, std::string> txCache;
+    // keys of committed events, so a late COMMIT copy is not applied twice
+    static structure::DigestSet committed(
+            config::IrohaConfigManager::getInstance().getCommitCacheSize(65536));
 
     static ThreadPool pool(ThreadPoolOptions{
         .threads_count =
@@ -65,12 +79,113 @@ namespace sumeragi {
                  config::IrohaConfigManager::getInstance().getPoolWorkerQueueSize(1024),
     });
 
+    // Pool tasks by urgency (whitepaper 2.6.1): commits first, then events
+    // ordered by the leader, then new events. The pool runs the most urgent
+    // queued task, so commits do not wait behind a burst of new transactions.
+    enum Priority : size_t {
+        COMMIT_PRIORITY,
+        ORDERED_PRIORITY,
+        NEW_PRIORITY,
+        PRIORITY_LEVELS
+    };
+    static structure::PriorityTaskQueue tasks(PRIORITY_LEVELS);
+
+    // panic() timeouts of undecided events, keyed by detail::eventKey()
+    static timer::TimeoutQueue timeouts;
+
+    // RTT of Verify::send by peer's ip, and round latency under "commit"
+    static timer::LatencyTracker latency;
+    static const std::string COMMIT_LATENCY = "commit";
+
+    // in-flight rounds, keyed by detail::eventKey()
+    static RoundTable rounds;
+
     namespace detail {
 
+        void schedule(Priority priority, std::function<void(void)> task) {
+            tasks.push(priority, std::move(task));
+            pool.process([]() { tasks.run_one(); });
+        }
+
         std::string hash(const Transaction& tx, const std::string& root) {
             return hash::sha3_256_hex(flatbuffer_service::toString(tx) + root);
         };
 
+        // same on every peer and at any height, unlike hash()
+        std::string eventKey(const Transaction& tx) {
+            return hash::sha3_256_hex(flatbuffer_service::toString(tx));
+        }
+
+        // abort decides its order without a transaction
+        bool isAbort(const ConsensusEvent& event) {
+            return event.transactions() == nullptr || event.transactions()->size() == 0;
+        }
+
+        // key of the round: of its transaction, or of the order for an abort
+        std::string eventKey(const ConsensusEvent& event) {
+            if (isAbort(event)) {
+                return hash::sha3_256_hex("abort:" + std::to_string(event.order()));
+            }
+            // Feature work #(tx) = 1
+            return eventKey(*event.transactions()->Get(0)->tx_nested_root());
+        }
+
+        // what a peer signs
+        std::string hash(const ConsensusEvent& event, const std::string& root) {
+            if (isAbort(event)) return hash::sha3_256_hex(eventKey(event) + root);
+            // ToDo: #(tx) = 1
+            return hash(*event.transactions()->Get(0)->tx_nested_root(), root);
+        }
+
+        // Event is decided: cancel its panic() and learn how long it took.
+        void finishRound(const std::string& key) {
+            timeouts.cancel(key);
+            RoundState round;
+            if (!rounds.erase(key, &round)) return;
+            latency.record(COMMIT_LATENCY,
+                           std::chrono::duration_cast<timer::LatencyTracker::duration>(
+                                   std::chrono::steady_clock::now() - round.start));
+        }
+
+        // remember signers of the event, returns number of distinct ones
+        size_t collectSignatures(const std::string& key, const ConsensusEvent& event) {
+            return rounds.update(key, [&](RoundState& round) {
+                for (auto&& sig : *event.peerSignatures()) {
+                    round.signers.insert(sig->publicKey()->str());
+                }
+                return round.signers.size();
+            });
+        }
+
+        // Returns true once per round, the first time it is asked: panic()
+        // timeout is set then, later copies of the event must not postpone it
+        bool armPanic(const std::string& key) {
+            bool first = false;
+            rounds.visit(key, [&](RoundState& round) {
+                first = !round.armed;
+                round.armed = true;
+            });
+            return first;
+        }
+
+        // p99 of round latency (or of chain of RTTs, until a round is decided)
+        // times factor, within configured bounds
+        std::chrono::milliseconds panicTimeout(std::uint64_t chainLength) {
+            auto& config = config::IrohaConfigManager::getInstance();
+            const std::chrono::milliseconds min(config.getPanicTimeoutMinMs(100));
+            const std::chrono::milliseconds max(config.getPanicTimeoutMaxMs(3000));
+            const double factor = config.getPanicTimeoutFactor(2.0);
+
+            auto base = latency.count(COMMIT_LATENCY) > 0
+                        ? latency.percentile(COMMIT_LATENCY, 99)
+                        : latency.percentile(99) * chainLength;
+            if (base == timer::LatencyTracker::duration::zero()) return max;
+
+            auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    base * factor);
+            return std::min(std::max(timeout, min), max);
+        }
+
         bool eventSignatureIsEmpty(const ::iroha::ConsensusEvent& event) {
             if (event.peerSignatures() != nullptr) {
                 return event.peerSignatures()->size() == 0;
@@ -79,14 +194,24 @@ namespace sumeragi {
             }
         }
 
+        bool signedBy(const ::iroha::ConsensusEvent& event, const std::string& publicKey) {
+            if (event.peerSignatures() == nullptr) return false;
+            for (auto&& sig : *event.peerSignatures()) {
+                if (sig->publicKey()->str() == publicKey) return true;
+            }
+            return false;
+        }
+
     }  // namespace detail
 
     struct Context {
-        bool isSumeragi = false;      // am I the leader or am I not?
+        bool isSumeragi = false;      // am I peer 0 (the leader, unless it rotates)?
         std::uint64_t maxFaulty = 0;  // f
         std::uint64_t proxyTailNdx = 0;
-        std::int32_t panicCount = 0;
-        std::int64_t commitedCount = 0;
+        std::uint64_t myNdx = 0;  // my position in validatingPeers
+        // updated from pool and timer threads
+        std::atomic<std::int32_t> panicCount{0};
+        std::atomic<std::int64_t> commitedCount{0};
         std::uint64_t numValidatingPeers = 0;
         std::string myPublicKey;
         std::string myPrivateKey;
@@ -138,6 +263,15 @@ namespace sumeragi {
                     config::PeerServiceConfig::getInstance().getMyPrivateKey();
             this->isSumeragi =
                     this->validatingPeers.at(0)->publicKey == this->myPublicKey;
+
+            // not a validator: position is past the last peer
+            this->myNdx = this->validatingPeers.size();
+            for (std::size_t i = 0; i < this->validatingPeers.size(); i++) {
+                if (this->validatingPeers[i]->publicKey == this->myPublicKey) {
+                    this->myNdx = i;
+                    break;
+                }
+            }
             logger::info("sumeragi") << "update finished";
 
             this->printProgress.MAX = 100;
@@ -146,6 +280,467 @@ namespace sumeragi {
 
     std::unique_ptr<Context> context = nullptr;
 
+    // keys of transactions this peer sent to the leader, so a transaction,
+    // which comes back while peers disagree on the leader, is held instead
+    static structure::DigestSet forwarded(
+            4 * config::IrohaConfigManager::getInstance().getMempoolMaxTransactions(1024));
+
+    // transactions received by Torii, until a round of them is started
+    static Mempool mempool(
+            config::IrohaConfigManager::getInstance().getMempoolMaxTransactions(1024),
+            config::IrohaConfigManager::getInstance().getMempoolMaxBytes(64 << 20),
+            config::IrohaConfigManager::getInstance().getMempoolMaxPerCreator(256));
+
+    /**
+     * Pipelined rounds: leader gives every event the next order (sequence
+     * number) and keeps at most `consensus_window` of them undecided, later
+     * transactions wait in the mempool for a free slot. Commits may arrive out of order, they
+     * are held in a reorder buffer and applied strictly by order.
+     *
+     * Leader rotates every `leader_rotation` orders: orders of one term are
+     * given by one peer, the next peer starts when the whole term is
+     * committed, so two leaders never give the same order.
+     *
+     * An order is never skipped. If it is not decided in time while later
+     * ones are (its event is lost with the leader, or the COMMIT is lost),
+     * peers decide an abort for it (see detail::requestOrder()). Every peer
+     * signs at most one event per order, so the leader's event and the abort
+     * are never both decided.
+     *
+     * The last applied order is committed with the ledger, it is not the
+     * height: transactions may be synced without orders.
+     */
+    struct Pipeline {
+        // event this peer signed for an order
+        struct Signed {
+            std::string key;
+            std::shared_ptr<flatbuffers::unique_ptr_t> event;  // own signed copy
+        };
+
+        std::mutex mutex;
+        bool initialized = false;
+        std::uint64_t window = 1;
+        std::uint64_t nextOrder = 0;   // leader: order of the next event
+        std::uint64_t rotation = 0;    // orders of a leader's term, 0 - no rotation
+        bool leading = false;          // this peer gives orders of the current term
+        std::uint64_t stalledAt = 0;   // order waited for by requestOrder(), 0 - none
+        // committed events by order, commits.next() is the next one to apply
+        ReorderBuffer commits;
+        // order => event signed for it, orders from commits.next()
+        std::map<std::uint64_t, Signed> locked;
+
+        // orders continue from the applied one, must be called with mutex locked
+        void init() {
+            if (initialized) return;
+            auto& config = config::IrohaConfigManager::getInstance();
+            window = std::max<std::uint64_t>(config.getConsensusWindow(8), 1);
+            rotation = config.getLeaderRotation(0);
+            nextOrder = repository::getOrder() + 1;
+            commits.reset(nextOrder, config.getDecisionHistory(1024));
+            initialized = true;
+        }
+    };
+    static Pipeline pipeline;
+
+    std::uint64_t getNextOrder() {
+        std::lock_guard<std::mutex> lock(pipeline.mutex);
+        pipeline.init();
+        return pipeline.nextOrder;
+    }
+
+    namespace detail {
+
+        void dispatch(const Transaction& tx, std::uint64_t order) {
+            auto eventUniqPtr = flatbuffer_service::toConsensusEvent(tx, order);
+            if (!eventUniqPtr) {
+                logger::error("sumeragi") << eventUniqPtr.error();
+                return;
+            }
+            context->printProgress.print(2, "make tx consensusEvent");
+            flatbuffers::unique_ptr_t ptr;
+            eventUniqPtr.move_value(ptr);
+            // send processTransaction(event) as a task to processing pool
+            // this returns std::future<void> object
+            // (std::future).get() method locks processing until result of
+            // processTransaction will be available but processTransaction returns
+            // void, so we don't have to call it and wait
+            auto event = std::make_shared<flatbuffers::unique_ptr_t>(std::move(ptr));
+            context->printProgress.print(3, "send event to processTransaction");
+            schedule(ORDERED_PRIORITY,
+                     [event]() { processTransaction(std::move(*event)); });
+        }
+
+        // index of the peer, which gives order, in validatingPeers
+        std::uint64_t leaderOf(std::uint64_t order) {
+            if (pipeline.rotation == 0 || order == 0) return 0;
+            return (order - 1) / pipeline.rotation % context->numValidatingPeers;
+        }
+
+        // index of the peer, which started the round: it signs the event first
+        std::uint64_t proposerOf(const ConsensusEvent& event) {
+            if (eventSignatureIsEmpty(event)) return 0;
+            const auto publicKey = event.peerSignatures()->Get(0)->publicKey()->str();
+            for (std::uint64_t i = 0; i < context->validatingPeers.size(); i++) {
+                if (context->validatingPeers[i]->publicKey == publicKey) return i;
+            }
+            return 0;
+        }
+
+        // this peer gives the next order, must be called with pipeline.mutex locked
+        bool leading() {
+            return leaderOf(pipeline.nextOrder) == context->myNdx;
+        }
+
+        // start transactions of the mempool while the window has free slots
+        // in this peer's term, must be called with pipeline.mutex locked
+        std::vector<std::pair<std::vector<uint8_t>, std::uint64_t>> takeWaiting() {
+            std::vector<std::pair<std::vector<uint8_t>, std::uint64_t>> started;
+            std::vector<uint8_t> tx;
+            while (pipeline.nextOrder < pipeline.commits.next() + pipeline.window &&
+                   leading() && mempool.pop(tx)) {
+                started.emplace_back(std::move(tx), pipeline.nextOrder++);
+            }
+            return started;
+        }
+
+        // Start transactions of the mempool, if this peer leads. Returns true
+        // when its term is over, transactions left in the mempool go to the
+        // next leader. Must be called with pipeline.mutex locked.
+        bool startWaiting(
+                std::vector<std::pair<std::vector<uint8_t>, std::uint64_t>>& started) {
+            const bool lead = leading();
+            const bool termOver = pipeline.leading && !lead;
+            pipeline.leading = lead;
+            if (lead) started = takeWaiting();
+            return termOver;
+        }
+
+        // ip of the peer, which gives the next order
+        std::string currentLeaderIp() {
+            std::lock_guard<std::mutex> lock(pipeline.mutex);
+            pipeline.init();
+            return context->validatingPeers.at(leaderOf(pipeline.nextOrder))->ip;
+        }
+
+        // Term is over: send transactions left in the mempool to the next
+        // leader. Ones it does not take stay here until this peer's next term.
+        void forwardLeftover() {
+            const auto leaderIp = currentLeaderIp();
+            std::vector<std::vector<uint8_t>> held;
+            std::vector<uint8_t> tx;
+            while (mempool.pop(tx)) {
+                const auto& root = *flatbuffers::GetRoot<Transaction>(tx.data());
+                if (connection::iroha::SumeragiImpl::Torii::send(leaderIp, root)) {
+                    forwarded.insert(structure::DigestSet::fromHex(eventKey(root)));
+                } else {
+                    held.push_back(std::move(tx));
+                }
+            }
+            for (auto&& t : held) {
+                const auto& root = *flatbuffers::GetRoot<Transaction>(t.data());
+                mempool.add(eventKey(root), root.creatorPubKey()->str(), std::move(t));
+            }
+        }
+
+        void dispatchAll(
+                std::vector<std::pair<std::vector<uint8_t>, std::uint64_t>>&& started) {
+            for (auto&& e : started) {
+                dispatch(*flatbuffers::GetRoot<Transaction>(e.first.data()), e.second);
+            }
+        }
+
+        // Every transaction is ordered by the leader of the current term: other
+        // peers send transactions received by Torii to it. Leader puts them to
+        // the mempool and orders them when the window has a slot. fromPeer -
+        // the transaction is forwarded by a peer, not sent by a client.
+        // Returns response code to the client.
+        iroha::Code admit(const Transaction& tx, bool fromPeer) {
+            const auto key = eventKey(tx);
+            const auto digest = structure::DigestSet::fromHex(key);
+            if (committed.contains(digest)) {
+                return iroha::Code::COMMIT;
+            }
+
+            std::string leaderIp;
+            {
+                std::lock_guard<std::mutex> lock(pipeline.mutex);
+                pipeline.init();
+                if (!leading()) {
+                    leaderIp = context->validatingPeers.at(leaderOf(pipeline.nextOrder))->ip;
+                }
+            }
+            if (!leaderIp.empty() && !forwarded.contains(digest)) {
+                if (!connection::iroha::SumeragiImpl::Torii::send(leaderIp, tx)) {
+                    // leader is busy or not reachable, client retries later
+                    return iroha::Code::BUSY;
+                }
+                forwarded.insert(digest);
+                return iroha::Code::UNDECIDED;
+            }
+            // client resubmits a forwarded transaction: the leader has it
+            if (!leaderIp.empty() && !fromPeer) {
+                return iroha::Code::UNDECIDED;
+            }
+            // transaction, which was sent to the leader and came back from a
+            // peer, is held until this peer's term
+
+            auto buf = flatbuffer_service::transaction::GetTxPointer(tx);
+            if (!buf) {
+                logger::error("sumeragi") << "Failed to copy transaction.";
+                return iroha::Code::FAIL;
+            }
+
+            switch (mempool.add(key, tx.creatorPubKey()->str(), std::move(buf.value()))) {
+                case Mempool::Admission::BUSY: {
+                    const auto stats = mempool.stats();
+                    logger::debug("sumeragi") << "mempool is full, size:" << stats.size
+                                              << " bytes:" << stats.bytes
+                                              << " rejected:" << stats.rejected;
+                    return iroha::Code::BUSY;
+                }
+                case Mempool::Admission::DUPLICATE:
+                    return iroha::Code::UNDECIDED;
+                case Mempool::Admission::ACCEPTED:
+                    break;
+            }
+
+            std::vector<std::pair<std::vector<uint8_t>, std::uint64_t>> started;
+            bool termOver;
+            {
+                std::lock_guard<std::mutex> lock(pipeline.mutex);
+                pipeline.init();
+                termOver = startWaiting(started);
+            }
+            dispatchAll(std::move(started));
+            if (termOver) schedule(NEW_PRIORITY, []() { forwardLeftover(); });
+            return iroha::Code::UNDECIDED;
+        }
+
+        // Transaction of an aborted order goes back to the mempool of the
+        // order's leader, to be ordered again. Must be called with
+        // pipeline.mutex locked.
+        void reorderAborted(std::uint64_t order) {
+            auto it = pipeline.locked.find(order);
+            if (it == pipeline.locked.end() || leaderOf(order) != context->myNdx) return;
+            const auto& event = *flatbuffers::GetRoot<ConsensusEvent>(it->second.event->get());
+            if (isAbort(event)) return;
+            // Feature work #(tx) = 1
+            const auto& tx = *event.transactions()->Get(0)->tx_nested_root();
+            auto buf = flatbuffer_service::transaction::GetTxPointer(tx);
+            if (!buf) return;
+            mempool.add(eventKey(tx), tx.creatorPubKey()->str(), std::move(buf.value()));
+        }
+
+        // order of the event is applied with it, so it is not applied twice
+        // after restart. Key is marked committed once the ledger is written,
+        // so an event, which failed to apply, is applied again.
+        // Must be called with pipeline.mutex locked.
+        void applyCommitted(const ConsensusEvent& event) {
+            const auto digest = structure::DigestSet::fromHex(eventKey(event));
+            if (isAbort(event)) {
+                reorderAborted(event.order());
+                runtime::processEmpty(event.order());
+            } else if (!committed.contains(digest)) {
+                // Feature work #(tx) = 1
+                runtime::processTransaction(
+                        *event.transactions()->Get(0)->tx_nested_root(), event.order());
+            } else {
+                // transaction is applied at an earlier order
+                runtime::processEmpty(event.order());
+            }
+            committed.insert(digest);
+        }
+
+        std::shared_ptr<flatbuffers::unique_ptr_t> copyEvent(const ConsensusEvent& event) {
+            flatbuffers::FlatBufferBuilder fbb;
+            auto offset = flatbuffer_service::copyConsensusEvent(fbb, event);
+            if (!offset) {
+                logger::error("sumeragi") << offset.error();
+                return nullptr;
+            }
+            fbb.Finish(offset.value());
+            return std::make_shared<flatbuffers::unique_ptr_t>(fbb.ReleaseBufferPointer());
+        }
+
+        // Every peer signs at most one event per order, the leader's one or an
+        // abort, so they never both get 2f+1 signatures. Abort is signed only
+        // by a peer, which waits for the order too, so it does not outrun the
+        // leader's event. Returns false if the event must not be signed:
+        // another one is signed for its order, or the order is applied already.
+        bool lockOrder(const ConsensusEvent& event, const std::string& key) {
+            std::lock_guard<std::mutex> lock(pipeline.mutex);
+            pipeline.init();
+            if (event.order() < pipeline.commits.next()) return false;
+            if (isAbort(event) &&
+                (event.order() != pipeline.commits.next() || pipeline.commits.empty())) {
+                return false;
+            }
+            auto it = pipeline.locked.find(event.order());
+            if (it != pipeline.locked.end()) return it->second.key == key;
+            auto copy = copyEvent(event);
+            if (!copy) return false;
+            pipeline.locked.emplace(event.order(), Pipeline::Signed{key, std::move(copy)});
+            return true;
+        }
+
+        // The event is of an order applied here: its sender (the peer, which
+        // signed it last, except this one) may wait for the order, it gets
+        // the COMMIT. Returns false if the order is not applied here.
+        bool answerDecided(const ConsensusEvent& event) {
+            std::shared_ptr<flatbuffers::unique_ptr_t> decided;
+            {
+                std::lock_guard<std::mutex> lock(pipeline.mutex);
+                pipeline.init();
+                if (event.order() >= pipeline.commits.next()) return false;
+                decided = pipeline.commits.decided(event.order());
+            }
+            if (!decided || event.peerSignatures() == nullptr) return true;
+
+            std::string sender;
+            for (auto&& sig : *event.peerSignatures()) {
+                if (sig->publicKey()->str() != context->myPublicKey) {
+                    sender = sig->publicKey()->str();
+                }
+            }
+            for (auto&& peer : context->validatingPeers) {
+                if (peer->publicKey == sender) {
+                    connection::iroha::SumeragiImpl::Verify::send(
+                            peer->ip, *flatbuffers::GetRoot<ConsensusEvent>(decided->get()));
+                }
+            }
+            return true;
+        }
+
+        void requestOrder(std::uint64_t order);
+
+        // Later orders are committed, but the next one is not: it is requested
+        // unless it is decided in time. Must be called with pipeline.mutex locked.
+        void watchStall() {
+            if (pipeline.commits.empty() || pipeline.stalledAt == pipeline.commits.next()) return;
+            const auto order = pipeline.stalledAt = pipeline.commits.next();
+            timeouts.set("stall", panicTimeout(context->proxyTailNdx + 1), [order]() {
+                schedule(COMMIT_PRIORITY, [order]() { requestOrder(order); });
+            });
+        }
+
+        // Order is still not decided here: send the event this peer signed
+        // for it to every peer, or propose an abort, if nothing is signed.
+        // Peers, which applied the order, answer with its COMMIT (see
+        // answerDecided()), others sign the event. Repeated while the order
+        // is waited for.
+        void requestOrder(std::uint64_t order) {
+            std::shared_ptr<flatbuffers::unique_ptr_t> own;
+            {
+                std::lock_guard<std::mutex> lock(pipeline.mutex);
+                if (order != pipeline.commits.next()) return;
+                pipeline.stalledAt = 0;
+                watchStall();
+                if (pipeline.commits.empty()) return;
+                auto it = pipeline.locked.find(order);
+                if (it != pipeline.locked.end()) own = it->second.event;
+            }
+            if (own) {
+                connection::iroha::SumeragiImpl::Verify::sendAll(
+                        *flatbuffers::GetRoot<ConsensusEvent>(own->get()));
+                return;
+            }
+
+            auto abortPtr = flatbuffer_service::makeAbort(order);
+            if (!abortPtr) {
+                logger::error("sumeragi") << abortPtr.error();
+                return;
+            }
+            logger::warning("sumeragi") << "order " << order
+                                        << " is not decided, propose abort";
+            flatbuffers::unique_ptr_t ptr;
+            abortPtr.move_value(ptr);
+            processTransaction(std::move(ptr));
+        }
+
+        // Keep received copy of the event, if it has new signatures.
+        // Returns true if the round has to be sent to the pool, otherwise
+        // the copy is dropped or will be merged by the worker of the round.
+        bool coalesce(const std::string& key, flatbuffers::unique_ptr_t&& eventUniqPtr) {
+            if (committed.contains(structure::DigestSet::fromHex(key))) return false;
+            const auto eventPtr = flatbuffers::GetRoot<ConsensusEvent>(eventUniqPtr.get());
+            if (eventSignatureIsEmpty(*eventPtr)) return false;
+            return rounds.update(key, [&](RoundState& round) {
+                if (round.phase == RoundPhase::COMMITTED) return false;
+                bool fresh = false;
+                for (auto&& sig : *eventPtr->peerSignatures()) {
+                    fresh |= round.signers.insert(sig->publicKey()->str()).second;
+                }
+                if (!fresh) return false;
+                round.pending.push_back(std::move(eventUniqPtr));
+                if (round.scheduled) return false;
+                round.scheduled = true;
+                return true;
+            });
+        }
+
+        // Process pending copies of the round merged into one event, until
+        // no new copies arrive, so one worker at a time runs the round.
+        void processRound(const std::string& key) {
+            while (true) {
+                std::vector<flatbuffers::unique_ptr_t> copies;
+                rounds.visit(key, [&](RoundState& round) {
+                    copies.swap(round.pending);
+                    if (copies.empty()) round.scheduled = false;
+                });
+                if (copies.empty()) return;  // no new copies, or round is over
+
+                auto merged = std::move(copies.front());
+                for (size_t i = 1; i < copies.size(); i++) {
+                    auto mergedSigs = flatbuffer_service::mergeSignatures(
+                            *flatbuffers::GetRoot<ConsensusEvent>(merged.get()),
+                            *flatbuffers::GetRoot<ConsensusEvent>(copies[i].get()));
+                    if (!mergedSigs) {
+                        logger::error("sumeragi") << mergedSigs.error();
+                        continue;
+                    }
+                    mergedSigs.move_value(merged);
+                }
+                processTransaction(std::move(merged));
+            }
+        }
+
+        // Apply committed events strictly by order, under pipeline.mutex, so
+        // every peer applies the same sequence, and only once.
+        void commit(flatbuffers::unique_ptr_t&& eventUniqPtr) {
+            std::vector<std::pair<std::vector<uint8_t>, std::uint64_t>> started;
+            bool termOver = false;
+            {
+                std::lock_guard<std::mutex> lock(pipeline.mutex);
+                pipeline.init();
+                const auto order =
+                        flatbuffers::GetRoot<ConsensusEvent>(eventUniqPtr.get())->order();
+                if (order < pipeline.commits.next()) return;  // already applied
+                // a copy of a held order is dropped, but applying is retried
+                pipeline.commits.push(order, std::move(eventUniqPtr));
+
+                try {
+                    pipeline.commits.drain([](std::uint64_t, const ReorderBuffer::Event& event) {
+                        applyCommitted(*flatbuffers::GetRoot<ConsensusEvent>(event->get()));
+                    });
+                } catch (...) {
+                    // ledger is not written: the event stays held and is
+                    // applied with the next commit, or waited for as stalled
+                    logger::error("sumeragi") << "order " << pipeline.commits.next()
+                                              << " is not applied";
+                }
+                pipeline.locked.erase(pipeline.locked.begin(),
+                                      pipeline.locked.lower_bound(pipeline.commits.next()));
+                watchStall();
+
+                pipeline.nextOrder = std::max(pipeline.nextOrder, pipeline.commits.next());
+                termOver = startWaiting(started);
+            }
+            dispatchAll(std::move(started));
+            if (termOver) schedule(NEW_PRIORITY, []() { forwardLeftover(); });
+        }
+
+    }  // namespace detail
+
     void initializeSumeragi() {
         logger::info("sumeragi") << "Sumeragi setted";
         logger::info("sumeragi") << "set number of validatingPeer";
@@ -156,26 +751,10 @@ namespace sumeragi {
                 [](const std::string& from, flatbuffers::unique_ptr_t&& transaction) {
                     context->printProgress.print(1, "receive transaction!");
 
-                    auto eventUniqPtr = flatbuffer_service::toConsensusEvent(
-                            *flatbuffers::GetRoot<::iroha::Transaction>(transaction.get()));
-
-                    if (eventUniqPtr) {
-                        context->printProgress.print(2, "make tx consensusEvent");
-                        flatbuffers::unique_ptr_t ptr;
-                        eventUniqPtr.move_value(ptr);
-                        // send processTransaction(event) as a task to processing pool
-                        // this returns std::future<void> object
-                        // (std::future).get() method locks processing until result of
-                        // processTransaction will be available but processTransaction returns
-                        // void, so we don't have to call it and wait
-                        auto&& task = [e = std::move(ptr)]() mutable {
-                            processTransaction(std::move(e));
-                        };
-                        context->printProgress.print(3, "send event to processTransaction");
-                        pool.process(std::move(task));
-                    } else {
-                        logger::error("sumeragi") << eventUniqPtr.error();
-                    }
+                    const auto& tx =
+                            *flatbuffers::GetRoot<::iroha::Transaction>(transaction.get());
+                    // "from" is the forwarding peer, empty for a client
+                    return detail::admit(tx, !from.empty());
                 });
 
         connection::iroha::SumeragiImpl::Verify::receive(
@@ -187,29 +766,35 @@ namespace sumeragi {
                     auto eventPtr =
                             flatbuffers::GetRoot<::iroha::ConsensusEvent>(eventUniqPtr.get());
 
+                    if (eventPtr->order() == 0) {
+                        // not ordered (sent by a peer of an older version): the
+                        // transaction goes to the leader to be ordered
+                        if (!detail::isAbort(*eventPtr)) {
+                            detail::admit(*eventPtr->transactions()->Get(0)->tx_nested_root(),
+                                          true);
+                        }
+                        return;
+                    }
+
+                    const auto key = detail::eventKey(*eventPtr);
                     if (eventPtr->code() == iroha::Code::COMMIT) {
                         context->printProgress.print(19, "receive commited event");
-                        // Feature work #(tx) = 1
-                        const auto txptr = eventPtr->transactions()->Get(0)->tx_nested_root();
-                        if (txCache.find(detail::hash(*txptr, repository::getMerkleRoot())) == txCache.end()) {
-                            txCache[detail::hash(*txptr, repository::getMerkleRoot())] = "commited";
-                            runtime::processTransaction(*txptr);
-                        }
+                        detail::finishRound(key);
+                        auto event = std::make_shared<flatbuffers::unique_ptr_t>(
+                                std::move(eventUniqPtr));
+                        detail::schedule(COMMIT_PRIORITY, [event]() {
+                            detail::commit(std::move(*event));
+                        });
+                    } else if (committed.contains(structure::DigestSet::fromHex(key))) {
+                        // late copy, or its sender missed the COMMIT
+                        detail::answerDecided(*eventPtr);
                     } else {
-                        // send processTransaction(event) as a task to processing pool
-                        // this returns std::future<void> object
-                        // (std::future).get() method locks processing until result of
-                        // processTransaction will be available but processTransaction returns
-                        // void, so we don't have to call it and wait
-                        // std::function<void()>&& task =
-                        //    std::bind(processTransaction, std::move(event));
-                        // pool.process(std::move(task));
-
-                        // Copy ConsensusEvent
-                        auto&& task = [e = std::move(eventUniqPtr)]() mutable {
-                            processTransaction(std::move(e));
-                        };
-                        pool.process(std::move(task));
+                        // copies of the event are merged, the round is sent to
+                        // the processing pool once, not once per copy
+                        if (detail::coalesce(key, std::move(eventUniqPtr))) {
+                            detail::schedule(ORDERED_PRIORITY,
+                                             [key]() { detail::processRound(key); });
+                        }
                     }
                 });
 
@@ -219,7 +804,7 @@ namespace sumeragi {
         logger::info("sumeragi") << "initialize proxyTailNdx :"
                                  << context->proxyTailNdx;
 
-        logger::info("sumeragi") << "initialize panicCount :" << context->panicCount;
+        logger::info("sumeragi") << "initialize panicCount :" << context->panicCount.load();
         logger::info("sumeragi") << "initialize myPublicKey :"
                                  << context->myPublicKey;
 
@@ -231,12 +816,6 @@ namespace sumeragi {
     }
 
 
-    std::uint64_t getNextOrder() {
-        return 0l;
-        // ToDo
-        // return merkle_transaction_repository::getLastLeafOrder() + 1;
-    }
-
     void processTransaction(flatbuffers::unique_ptr_t&& eventUniqPtr) {
         // Do not touch directly
         flatbuffers::unique_ptr_t storageUniqPtr;
@@ -257,13 +836,15 @@ namespace sumeragi {
         context->printProgress.print(5, "set input's event unique ptr");
         resetUniqPtr(std::move(eventUniqPtr));
 
-        context->printProgress.print(6, "generate hash");
+        const auto key = detail::eventKey(*getRoot());
+
+        // merged copies of the event may carry own signature already
+        bool signedNow = false;
+        if (!detail::signedBy(*getRoot(), context->myPublicKey)) {
+            context->printProgress.print(6, "generate hash");
+
+            const auto hash = detail::hash(*getRoot(), repository::getMerkleRoot());
 
-        const auto hash = detail::hash(
-                *getRoot()->transactions()->Get(0)->tx_nested_root(),
-                repository::getMerkleRoot()
-        );  // ToDo: #(tx) = 1
-        {
             context->printProgress.print(7, "sign hash using my key-pair");
 
             const auto signature =
@@ -281,6 +862,16 @@ namespace sumeragi {
             flatbuffers::unique_ptr_t uptr;
             sigAddPtr.move_value(uptr);
             resetUniqPtr(std::move(uptr));
+
+            if (!detail::lockOrder(*getRoot(), key)) {
+                // signature is dropped: another event of the order is signed,
+                // or the order is applied and the sender may wait for it.
+                // The round is forgotten, so a later copy is asked again.
+                rounds.erase(key);
+                detail::answerDecided(*getRoot());
+                return;
+            }
+            signedNow = true;
         }
 
         context->printProgress.print(9, "if statement");
@@ -288,9 +879,8 @@ namespace sumeragi {
             context->printProgress.print(
                     11, "event doesn't have signature and I'm Sumeragi");
 
-            // Determine the order for processing this event
-            // event.set_order(getNextOrder());//TODO getNexOrder is always return 0l;
-            // logger::info("sumeragi") << "new  order:" << event.order();
+            // order of the event is given by detail::admit()
+            logger::info("sumeragi") << "order:" << getRoot()->order();
         } else if (!detail::eventSignatureIsEmpty(*getRoot())) {
             context->printProgress.print(10, "event has signature");
             explore::sumeragi::printInfo(
@@ -308,12 +898,20 @@ namespace sumeragi {
                                               context->maxFaulty * 2 + 1);
                 explore::sumeragi::printAgree();
 
+                // copies of the event may reach 2f+1 in parallel, commit once
+                const bool first = rounds.update(key, [](RoundState& round) {
+                    const bool signing = round.phase == RoundPhase::SIGNING;
+                    round.phase = RoundPhase::COMMITTED;
+                    return signing;
+                });
+                if (!first) return;
+
                 context->printProgress.print(16, "commit");
 
-                context->commitedCount++;
+                const auto commitedCount = ++context->commitedCount;
 
                 explore::sumeragi::printInfo("commit count:" +
-                                             std::to_string(context->commitedCount));
+                                             std::to_string(commitedCount));
 
                 context->printProgress.print(17, "update event commit");
 
@@ -328,62 +926,71 @@ namespace sumeragi {
                     resetUniqPtr(std::move(uptr));
                 }
 
+                detail::finishRound(key);
+
                 context->printProgress.print(18, "SendAll");
                 connection::iroha::SumeragiImpl::Verify::sendAll(*getRoot());
+                // sendAll skips this peer, so the commit is applied here
+                detail::commit(std::move(storageUniqPtr));
 
             } else {
-
-                {
-                    context->printProgress.print(7, "sign hash using my key-pair");
-
-                    const auto signature =
-                            signature::sign(hash, context->myPublicKey, context->myPrivateKey);
-                    explore::sumeragi::printInfo("hash:" + hash + " signature:" + signature);
-
-                    context->printProgress.print(8, "Add own signature");
-
-                    auto sigAddPtr = flatbuffer_service::addSignature(
-                            *getRoot(), context->myPublicKey, signature);
-                    if (!sigAddPtr) {
-                        logger::error("sumeragi") << "Failed to process transaction.";
-                        return;  // ToDo: If processTx fails, is it ok to return immediately?
-                    }
-                    flatbuffers::unique_ptr_t uptr;
-                    sigAddPtr.move_value(uptr);
-                    resetUniqPtr(std::move(uptr));
-                }
-
+                // own signature is already added above, every peer signs once
                 explore::sumeragi::printInfo("Signature exists and sig not enough");
-                context->printProgress.print(12, "add peer signature to event");
 
+                // set A starts at the proposer (leader of the order, or the peer
+                // which got the transaction), so it rotates with the leader
+                const auto n = context->numValidatingPeers;
+                const auto proposer = detail::proposerOf(*getRoot());
+                const auto position = (context->myNdx + n - proposer) % n;
                 explore::sumeragi::printInfo(
                         "tail public key is " +
-                        context->validatingPeers.at(context->proxyTailNdx)->publicKey);
+                        context->validatingPeers.at((proposer + context->proxyTailNdx) % n)
+                                ->publicKey);
 
+                // BChain: the event goes along set A, one peer at a time, so a
+                // round costs O(n) messages. Only COMMIT is sent to all.
                 context->printProgress.print(13, "If statements [ Am I tail or not?");
-                if (context->validatingPeers.at(context->proxyTailNdx)->publicKey ==
-                    context->myPublicKey) {
+                if (detail::isAbort(*getRoot())) {
+                    // abort is proposed by a peer, which waits for the order,
+                    // the chain of the order's leader may be broken: every
+                    // peer sends its signature to all
+                    if (signedNow) {
+                        connection::iroha::SumeragiImpl::Verify::sendAll(*getRoot());
+                    }
+                } else if (context->myNdx < n && position < context->proxyTailNdx) {
+                    const auto& next = context->validatingPeers.at((context->myNdx + 1) % n);
                     explore::sumeragi::printInfo(
                             "currently signature number:" +
                             std::to_string(getRoot()->peerSignatures()->size()));
-                    context->printProgress.print(
-                            14, "send to " +
-                                context->validatingPeers.at(context->proxyTailNdx)->ip);
+                    context->printProgress.print(14, "send to " + next->ip);
 
-                    connection::iroha::SumeragiImpl::Verify::send(
-                            context->validatingPeers.at(context->proxyTailNdx)->ip,
-                            *getRoot());  // Think In Process
+                    auto sent = std::chrono::steady_clock::now();
+                    if (connection::iroha::SumeragiImpl::Verify::send(next->ip, *getRoot())) {
+                        latency.record(next->ip,
+                                       std::chrono::duration_cast<timer::LatencyTracker::duration>(
+                                               std::chrono::steady_clock::now() - sent));
+                    }
                 } else {
+                    // proxy tail (or set B) waits for signatures, panic() expands set A
                     explore::sumeragi::printInfo(
                             "currently signature number:" +
                             std::to_string(getRoot()->peerSignatures()->size()));
-
-                    context->printProgress.print(14, "send all");
-                    connection::iroha::SumeragiImpl::Verify::sendAll(*getRoot());
-                    //
                 }
 
-                timer::setAwkTimerForCurrentThread(3000, [&]() { panic(*getRoot()); });
+                // worker is not blocked, panic() runs on the timer thread
+                // unless the event is committed in time
+                detail::collectSignatures(key, *getRoot());
+                if (!detail::armPanic(key)) return;
+                auto event = std::make_shared<flatbuffers::unique_ptr_t>(
+                        std::move(storageUniqPtr));
+                timeouts.set(key, detail::panicTimeout(context->proxyTailNdx + 1), [event, key]() {
+                    rounds.erase(key);
+                    // panic() sends to every peer, it must not block the
+                    // timer thread, which runs other timeouts ("stall")
+                    detail::schedule(COMMIT_PRIORITY, [event]() {
+                        panic(*flatbuffers::GetRoot<ConsensusEvent>(event->get()));
+                    });
+                });
             }
         }
     }
@@ -399,34 +1006,23 @@ namespace sumeragi {
  * |---|  |---|  |---|  |---|  |---|  |---|,
  *
  * if 2f+1 signature are not received within the timer's limit, then
- * the set of considered validators, A, is expanded by f (e.g., by 1 in the
- * example below):
- *  ________________________    __________
- * /           A            \  /    B     \
+ * the set of considered validators, A, is expanded to every peer: the event
+ * is sent to all of them, peers of set B sign it and send it on when their
+ * own timers expire, so signatures reach every live peer:
+ *  _______________________________________
+ * /                   A                   \
  * |---|  |---|  |---|  |---|  |---|  |---|
  * | 0 |--| 1 |--| 2 |--| 3 |--| 4 |--| 5 |
  * |---|  |---|  |---|  |---|  |---|  |---|.
+ *
+ * Any peer, which gets 2f+1 signatures, commits the event. Peers, which
+ * applied its order already, answer with the COMMIT (see
+ * detail::answerDecided()).
  */
     void panic(const ConsensusEvent& event) {
-        context->panicCount++;  // TODO: reset this later
-        auto broadcastStart =
-                2 * context->maxFaulty + 1 + context->maxFaulty * context->panicCount;
-        auto broadcastEnd = broadcastStart + context->maxFaulty;
-
-        // Do some bounds checking
-        if (broadcastStart > context->numValidatingPeers - 1) {
-            broadcastStart = context->numValidatingPeers - 1;
-        }
-
-        if (broadcastEnd > context->numValidatingPeers - 1) {
-            broadcastEnd = context->numValidatingPeers - 1;
-        }
-
-        logger::info("sumeragi") << "broadcastEnd:" << broadcastEnd;
-        logger::info("sumeragi") << "broadcastStart:" << broadcastStart;
-        // WIP issue hash event
-        // connection::sendAll(event->transaction().hash()); //TODO: change this to
-        // only broadcast to peer range between broadcastStart and broadcastEnd
+        const auto panicCount = ++context->panicCount;
+        logger::info("sumeragi") << "panic:" << panicCount << " order:" << event.order();
+        connection::iroha::SumeragiImpl::Verify::sendAll(event);
     }
 
 /**
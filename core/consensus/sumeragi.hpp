@@ -34,7 +34,7 @@ void initializeSumeragi();
 
 void loop();
 
-void getNextOrder(std::unique_ptr<ConsensusEvent> event);
+std::uint64_t getNextOrder();
 
 void processTransaction(flatbuffers::unique_ptr_t&& event);
 
@@ -20,6 +20,7 @@
 
 #include <ametsuchi/currency.h>
 #include <ametsuchi/merkle_tree/merkle_tree.h>
+#include <ametsuchi/sharded_wsv.h>
 #include <ametsuchi/tx_store.h>
 #include <ametsuchi/wsv.h>
 #include <commands_generated.h>
@@ -27,6 +28,8 @@
 #include <lmdb.h>
 #include <transaction_generated.h>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -37,14 +40,14 @@ extern "C" {
 #include <SimpleFIPS202.h>
 }
 
-#ifndef AMETSUCHI_MAX_DB_SIZE
-#define AMETSUCHI_MAX_DB_SIZE (1024L * 1024 * 1024 * 1024)  // 1 TB
-#endif
-
 #ifndef AMETSUCHI_BLOCK_SIZE
 #define AMETSUCHI_BLOCK_SIZE (1024)  // the number of leafs in merkle tree
 #endif
 
+#ifndef AMETSUCHI_WSV_SHARDS
+#define AMETSUCHI_WSV_SHARDS (1)  // 1 - WSV is stored together with TX store
+#endif
+
 namespace ametsuchi {
 
 
@@ -54,10 +57,21 @@ namespace ametsuchi {
  *  - single writer thread
  *  - multiple readers threads, new read-only transaction for each thread
  *  - all data is stored as root flatbuffers
+ *  - WSV may be partitioned by account into several environments, each of
+ *    them has its own writer thread (see ShardedWSV)
  */
 class Ametsuchi {
  public:
-  explicit Ametsuchi(const std::string &db_folder);
+  /**
+   * @param db_folder - database folder
+   * @param wsv_shards - number of environments for WSV. If 1, WSV is stored
+   * in the same environment with TX store.
+   * @param tx_compression_level - zstd level for stored transactions, 0
+   * disables compression (see TxStore)
+   */
+  explicit Ametsuchi(
+      const std::string &db_folder, size_t wsv_shards = AMETSUCHI_WSV_SHARDS,
+      int tx_compression_level = AMETSUCHI_TX_COMPRESSION_LEVEL);
   ~Ametsuchi();
 
   /**
@@ -82,9 +96,77 @@ class Ametsuchi {
    */
   void rollback();
 
+  /**
+   * Move committed transactions up to index \p upto to the cold tier:
+   * immutable segment files in db_folder/segments/. Archived transactions
+   * are still returned by every query, LMDB keeps only the hot tail.
+   * @throw exception::InternalError::UNCOMMITTED if there are appended
+   * transactions, they must be committed or rolled back first
+   * @return index of the last archived transaction
+   */
+  size_t archive(size_t upto);
+
+  /**
+   * Write compact snapshot of the committed world state to \p folder: WSV
+   * trees, merkle tree frontier and TX store metadata, without transaction
+   * history. WSV shards are copied to \p folder/wsv_shard_<i>/. Snapshot is
+   * written to a temporary folder and renamed, so \p folder is complete if
+   * it exists. May be called from any thread, it waits for commit(), so TX
+   * store and every shard are copied at the same height.
+   * @return height and merkle root of the snapshot
+   */
+  SnapshotInfo exportSnapshot(const std::string &folder);
+
+  /**
+   * Make snapshot \p snapshot_folder (see exportSnapshot) the database in
+   * \p db_folder by renaming it. Previous database is moved to
+   * <db_folder>.old and removed. Ametsuchi must not be open in \p db_folder
+   * and must be opened with the same number of WSV shards as the exporter.
+   */
+  static void installSnapshot(const std::string &snapshot_folder,
+                              const std::string &db_folder);
+
+  /**
+   * Returns index of the last committed transaction, or the last appended
+   * one if \p uncommitted is true.
+   */
+  size_t height(bool uncommitted = false);
+
+  /**
+   * Record consensus order of the last decided event in the append
+   * transaction. It is committed atomically with the event's transactions,
+   * so a restarted peer continues from the order it has applied.
+   */
+  void setOrder(uint64_t order);
 
-  const ::iroha::Transaction *getTransaction(size_t index,
-                                             bool uncommitted = false);
+  /**
+   * Returns consensus order of the last committed decision, 0 if there is
+   * none. It is independent of height: transactions may be synced without
+   * orders.
+   */
+  uint64_t order();
+
+  /**
+   * Store attachment data out of line, in the append transaction. Equal
+   * attachments are stored once. Transaction, which refers to the attachment
+   * by digest, may be appended after this call.
+   * @return sha3_256 of \p data, value of Attachment.digest
+   */
+  merkle::hash_t putAttachment(const std::vector<uint8_t> &data);
+
+  /**
+   * Returns attachment data stored out of line, data is nullptr if there is
+   * no attachment with \p digest.
+   */
+  AM_val getAttachment(const merkle::hash_t &digest, bool uncommitted = false);
+
+
+  /**
+   * Returns transaction with \p index. Pointer keeps decompressed
+   * transaction alive, mmaped one is not owned.
+   */
+  std::shared_ptr<const ::iroha::Transaction> getTransaction(
+      size_t index, bool uncommitted = false);
 
   // ********************
   // Ametsuchi queries:
@@ -106,7 +188,8 @@ class Ametsuchi {
    * @param asset_name - asset (currency) name
    * @param uncommitted - if true, include uncommitted changes to search.
  * Otherwise create new read-only TX
-   * @return pair <pointer, size>, which are mmaped from disk
+   * @return pointer to asset, which is mmaped from disk, or nullptr if
+   * account has no such asset
    */
   const ::iroha::Asset *accountGetAsset(const flatbuffers::String *pubKey,
                                         const flatbuffers::String *ledger_name,
@@ -114,12 +197,38 @@ class Ametsuchi {
                                         const flatbuffers::String *asset_name,
                                         bool uncommitted = false);
 
+  /**
+   * Returns account's asset as of ledger height \p height, i.e. after the
+   * transaction with index \p height was applied. Every balance change is
+   * versioned, so the lookup is O(log n) and does not replay TX store.
+   * @return pointer to asset or nullptr if account had no such asset then
+   */
+  const ::iroha::Asset *accountGetAssetAt(
+      const flatbuffers::String *pubKey, const flatbuffers::String *ledger_name,
+      const flatbuffers::String *domain_name,
+      const flatbuffers::String *asset_name, size_t height,
+      bool uncommitted = false);
 
+  /**
+   * Returns created asset.
+   * @return pointer to asset or nullptr if asset is not created
+   */
   const ::iroha::Asset *assetidGetAsset(const std::string &&ledger_name,
                                         const std::string &&domain_name,
                                         const std::string &&asset_name,
                                         bool uncommitted = false);
 
+  /**
+   * Returns aggregates of created asset: total supply and number of accounts
+   * with non-zero balance. Aggregates are maintained on every
+   * add/subtract/transfer, so this query does not scan accounts.
+   * @return zero stats if asset is not created
+   */
+  AssetStats assetGetStats(const std::string &ledger_name,
+                           const std::string &domain_name,
+                           const std::string &asset_name,
+                           bool uncommitted = false);
+
   const std::vector<const ::iroha::AccountPermissionLedger *>
   assetGetPermissionLedger(const flatbuffers::String *pubKey);
 
@@ -129,6 +238,10 @@ class Ametsuchi {
   const std::vector<const ::iroha::AccountPermissionAsset *>
   assetGetPermissionAsset(const flatbuffers::String *pubKey);
 
+  /**
+   * Returns peer with \p pubKey.
+   * @return pointer to peer or nullptr if there is no such peer
+   */
   const ::iroha::Peer *pubKeyGetPeer(const flatbuffers::String *pubKey,
                                      bool uncommitted = false);
 
@@ -142,8 +255,41 @@ class Ametsuchi {
                                       iroha::Command command,
                                       bool uncommitted = false);
 
+  /**
+   * Returns every transaction, which touches account with \p pubKey (as a
+   * creator, sender, receiver or target account), ordered by index.
+   * @param pubKey - account's public key
+   * @param uncommitted - if true, include uncommitted changes to search.
+   * Otherwise create new read-only TX
+   */
+  std::vector<HistoryRecord> getAccountHistory(
+      const flatbuffers::String *pubKey, bool uncommitted = false);
+
+  /**
+   * Returns transactions, which touch account with \p pubKey and have
+   * timestamp in [from, to], ordered by index.
+   */
+  std::vector<HistoryRecord> getAccountHistory(
+      const flatbuffers::String *pubKey, uint64_t from, uint64_t to,
+      bool uncommitted = false);
+
+  /**
+   * Returns transactions with timestamp in [from, to], ordered by timestamp.
+   * @param uncommitted - if true, include uncommitted changes to search.
+   * Otherwise create new read-only TX
+   */
+  std::vector<AM_val> getTransactionsByTime(uint64_t from, uint64_t to,
+                                            bool uncommitted = false);
+
   const std::string getMerkleRoot();
 
+  /**
+   * Returns committed merkle root after transaction \p height, empty string
+   * if it is unknown. Roots at equal heights differ if and only if ledgers
+   * diverged at or before that height.
+   */
+  const std::string getMerkleRoot(size_t height);
+
  private:
   /* for internal use only */
 
@@ -155,10 +301,19 @@ class Ametsuchi {
   TxStore tx_store;
   WSV wsv;
 
+  size_t wsv_shards_;
+  std::unique_ptr<ShardedWSV> shards_;
+
+  // held by commit() and exportSnapshot(): TX store and shards are committed
+  // one after another, a snapshot must not see them in between
+  std::mutex commit_mutex_;
+
   uint32_t AMETSUCHI_TREES_TOTAL;
 
 
   void init();
+  // apply committed transactions to WSV shards, which are behind TX store
+  void replay_shards();
 
   void init_append_tx();
   void abort_append_tx();
@@ -22,14 +22,32 @@
 #include <ametsuchi/exception.h>
 #include <flatbuffers/flatbuffers.h>
 #include <lmdb.h>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#ifndef AMETSUCHI_MAX_DB_SIZE
+#define AMETSUCHI_MAX_DB_SIZE (1024L * 1024 * 1024 * 1024)  // 1 TB
+#endif
+
 namespace ametsuchi {
 
 extern std::shared_ptr<spdlog::logger> console;
 
+/**
+ * Create folder \p path (if needed) and open LMDB environment in it.
+ * @param path - database folder
+ * @param trees_total - maximum number of named trees in the environment
+ * @return opened environment
+ */
+MDB_env *init_env(const std::string &path, uint32_t trees_total);
+
+/**
+ * Remove folder \p path with everything in it, if it exists.
+ */
+void remove_folder(const std::string &path);
+
 inline std::pair<MDB_dbi, MDB_cursor *> init_btree(
     MDB_txn *append_tx, const std::string &name, uint32_t flags,
     MDB_cmp_func *dupsort = nullptr) {
@@ -64,7 +82,12 @@ struct AM_val {
   const void *const data;
   // size of the pointer
   const size_t size;
+  // buffer, which holds data if it is not mmaped (e.g. decompressed
+  // transaction), it lives as long as any copy of the value
+  std::shared_ptr<const std::vector<uint8_t>> owner;
   explicit AM_val(const MDB_val &a) : data(a.mv_data), size(a.mv_size) {}
+  explicit AM_val(std::shared_ptr<const std::vector<uint8_t>> blob)
+      : data(blob->data()), size(blob->size()), owner(std::move(blob)) {}
 };
 
 
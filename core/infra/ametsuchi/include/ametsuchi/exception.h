@@ -74,10 +74,13 @@ enum class InvalidTransaction {
   ACCOUNT_EXISTS,
   ACCOUNT_NOT_FOUND,
   NOT_ENOUGH_ASSETS,
-  WRONG_COMMAND
+  WRONG_COMMAND,
+  ATTACHMENT_NOT_FOUND
 };
 
-enum class InternalError { FATAL, NOT_IMPLEMENTED };
+// UNCOMMITTED - operation requires committed state, but there are appended
+// transactions
+enum class InternalError { FATAL, NOT_IMPLEMENTED, UNCOMMITTED };
 
 #define AMETSUCHI_CRITICAL(res, err)                                      \
   if (res == err) {                                                       \
@@ -0,0 +1,93 @@
+/**
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AMETSUCHI_SEGMENT_STORE_H
+#define AMETSUCHI_SEGMENT_STORE_H
+
+#include <ametsuchi/common.h>
+#include <lmdb.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef AMETSUCHI_SEGMENT_INDEX_STEP
+#define AMETSUCHI_SEGMENT_INDEX_STEP (64)  // records per sparse index entry
+#endif
+
+namespace ametsuchi {
+
+/**
+ * Cold tier of TX store: immutable append-only segment files.
+ *  - every segment holds consecutive transactions [first, first + count)
+ *  - segment is written once to a temporary file and renamed, so it is
+ *    either complete or absent
+ *  - segments are mmaped read-only, records are returned without copy
+ *
+ * Segment file layout:
+ *   header: "AMSG", uint32 index step, uint64 first, uint64 count
+ *   records: uint64 size, blob padded to 8 bytes
+ *   sparse index: uint64 offset of every index step-th record
+ *   footer: uint64 offset of the sparse index
+ */
+class SegmentStore {
+ public:
+  /**
+   * Open every segment in \p folder, create folder if needed.
+   */
+  explicit SegmentStore(const std::string &folder);
+  ~SegmentStore();
+
+  /**
+   * Write new segment with records [first, first + records.size()).
+   * \p first must follow the last archived index, if there are segments.
+   */
+  void write(size_t first, const std::vector<AM_val> &records);
+
+  /**
+   * Find record \p index in segments.
+   * @return false if the record is not archived
+   */
+  bool get(size_t index, MDB_val &val) const;
+
+  /**
+   * Returns index of the last archived record, 0 if there are no segments.
+   */
+  size_t last() const;
+
+ private:
+  struct Segment {
+    size_t first;
+    size_t count;
+    uint32_t step;
+    const uint8_t *data;
+    size_t size;
+    const uint64_t *sparse;
+  };
+
+  std::string folder_;
+  // sorted by first index, guarded by mutex_ (readers and archive may run
+  // in different threads)
+  std::vector<Segment> segments_;
+  mutable std::mutex mutex_;
+
+  void open(const std::string &path);
+};
+
+}  // namespace ametsuchi
+
+#endif  // AMETSUCHI_SEGMENT_STORE_H
@@ -0,0 +1,164 @@
+/**
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AMETSUCHI_SHARDED_WSV_H
+#define AMETSUCHI_SHARDED_WSV_H
+
+#include <ametsuchi/common.h>
+#include <ametsuchi/wsv.h>
+#include <lmdb.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ametsuchi {
+
+/**
+ * World state, partitioned by account public key into independent LMDB
+ * environments (shards).
+ *  - every shard has its own environment, append transaction and writer thread
+ *  - a transaction is applied by every shard in parallel, each shard writes
+ *    only accounts it owns (see WSV::set_partition)
+ *  - commit is coordinated: every shard commits its append transaction
+ *  - every shard stores the index of the last transaction it applied in the
+ *    same LMDB transaction as the data, so a shard, which was not committed
+ *    because of crash, is found on open and replayed from TX store
+ */
+class ShardedWSV {
+ public:
+  /**
+   * Open \p shards environments in \p db_folder/wsv_shard_<i>/
+   */
+  ShardedWSV(const std::string &db_folder, size_t shards);
+  ~ShardedWSV();
+
+  /**
+   * Apply transaction(s) to every shard, wait until all shards are done.
+   * Transfer between shards is applied by the sender's shard first, the
+   * receiver's shard is not updated if it throws.
+   * @param height - index of the (first) transaction in TX store
+   * @throw first exception thrown by a shard
+   */
+  void update(const std::vector<uint8_t> *blob, size_t height);
+  void update(const std::vector<std::vector<uint8_t> *> &batch, size_t height);
+
+  /**
+   * Apply transaction to shard \p index only. Used to replay transactions
+   * to a shard, which is behind TX store.
+   */
+  void update(size_t index, const std::vector<uint8_t> *blob, size_t height);
+
+  /**
+   * Returns index of the last transaction committed by shard \p index,
+   * 0 if it has not committed any.
+   */
+  size_t committed_height(size_t index) const;
+
+  /**
+   * Commit append transaction of every shard.
+   */
+  void commit();
+
+  /**
+   * Rollback append transaction of every shard.
+   */
+  void rollback();
+
+  /**
+   * Write compact copy of committed state of every shard to
+   * \p db_folder/wsv_shard_<i>/ (mdb_env_copy2 with MDB_CP_COMPACT).
+   */
+  void snapshot(const std::string &db_folder);
+
+  /**
+   * Returns shard, which stores account with \p pubKey
+   */
+  size_t shard_of(const flatbuffers::String *pubKey) const;
+
+  size_t size() const;
+
+  /**
+   * Run \p f(wsv, env) in the writer thread of shard \p index and return its
+   * result. Queries to uncommitted data must be run in the writer thread,
+   * because LMDB write transaction belongs to the thread which created it.
+   */
+  template <typename F>
+  auto run(size_t index, F &&f)
+      -> decltype(f(std::declval<WSV &>(), std::declval<MDB_env *>())) {
+    auto &shard = *shards_.at(index);
+    return submit(shard, [&shard, &f] { return f(shard.wsv, shard.env); })
+        .get();
+  }
+
+ private:
+  struct Shard {
+    std::string path;
+    MDB_env *env;
+    MDB_txn *append_tx_;
+    MDB_dbi meta;
+    WSV wsv;
+    size_t height;            // last applied transaction
+    size_t committed_height;  // last committed transaction
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> tasks;
+    bool stop;
+  };
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  template <typename F>
+  auto submit(Shard &shard, F &&f) -> std::future<decltype(f())> {
+    auto task =
+        std::make_shared<std::packaged_task<decltype(f())()>>(std::forward<F>(f));
+    auto future = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.tasks.emplace_back([task] { (*task)(); });
+    }
+    shard.cv.notify_one();
+    return future;
+  }
+
+  /**
+   * Run \p f in every shard in parallel, wait for all of them.
+   * @throw first exception thrown by a shard
+   */
+  void for_each(const std::function<void(Shard &)> &f);
+
+  /**
+   * Returns sender's shard of a transfer between two shards, size() if
+   * \p blob is not such transfer.
+   */
+  size_t debit_shard(const std::vector<uint8_t> *blob) const;
+
+  void init_append_tx(Shard &shard);
+  void abort_append_tx(Shard &shard);
+  void writer_loop(Shard &shard);
+};
+
+}  // namespace ametsuchi
+
+#endif  // AMETSUCHI_SHARDED_WSV_H
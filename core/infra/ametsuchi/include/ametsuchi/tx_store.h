@@ -20,10 +20,43 @@
 
 #include <ametsuchi/common.h>
 #include <ametsuchi/merkle_tree/merkle_tree.h>
+#include <ametsuchi/segment_store.h>
 #include <commands_generated.h>
 #include <flatbuffers/flatbuffers.h>
 #include <lmdb.h>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
+
+#ifndef AMETSUCHI_TX_COMPRESSION_LEVEL
+#define AMETSUCHI_TX_COMPRESSION_LEVEL (0)  // 0 - store transactions as is
+#endif
+
+#ifndef AMETSUCHI_TX_DICT_SAMPLES
+#define AMETSUCHI_TX_DICT_SAMPLES (1024)  // transactions to train dictionary
+#endif
+
+#ifndef AMETSUCHI_TX_DICT_SIZE
+#define AMETSUCHI_TX_DICT_SIZE (64 * 1024)  // max size of dictionary, bytes
+#endif
+
+#ifndef AMETSUCHI_ATTACHMENT_THRESHOLD
+#define AMETSUCHI_ATTACHMENT_THRESHOLD (4 * 1024)  // bytes, larger attachments
+                                                   // are stored out of line
+#endif
+
+#ifndef AMETSUCHI_TX_CACHE_SIZE
+#define AMETSUCHI_TX_CACHE_SIZE (1024)  // decompressed transactions in memory
+#endif
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
 
 namespace std {
     template <class T>
@@ -38,20 +71,109 @@ namespace std {
 
 namespace ametsuchi {
 
+/**
+ * Transaction, which touches an account (see TxStore::getAccountHistory).
+ */
+struct HistoryRecord {
+  // index of the transaction in tx_store
+  size_t index;
+  // command of the transaction
+  iroha::Command command;
+  // root flatbuffer Transaction
+  AM_val tx;
+};
+
+/**
+ * Committed state, written to a snapshot (see TxStore::snapshot).
+ */
+struct SnapshotInfo {
+  // index of the last transaction applied to the world state
+  size_t height;
+  // merkle root after that transaction
+  merkle::hash_t root;
+};
+
+/**
+ * Transaction store.
+ * If compression is enabled, the first AMETSUCHI_TX_DICT_SAMPLES
+ * transactions are stored as is and used to train zstd dictionary, next ones
+ * are stored compressed with it. Both kinds of records may be read, plain
+ * records are returned without copy, compressed ones are decompressed into
+ * a buffer owned by the returned value (see AM_val::owner) and shared with
+ * the cache.
+ */
 class TxStore {
  public:
-  TxStore(size_t merkle_leaves);
+  /**
+   * @param merkle_leaves - number of leaves in merkle tree block
+   * @param compression_level - zstd level, 0 disables compression
+   */
+  TxStore(size_t merkle_leaves,
+          int compression_level = AMETSUCHI_TX_COMPRESSION_LEVEL);
   ~TxStore();
 
   void commit();
 
+  // (re)build in-memory merkle tree from the committed one
   void init_merkle_tree();
 
   merkle::hash_t merkle_root();
 
+  /**
+   * Read committed merkle root after transaction \p height was appended.
+   * @return false if there is no root at this height (e.g. it is below
+   * snapshot height)
+   */
+  bool merkle_root(size_t height, merkle::hash_t &root, MDB_env *env);
+
   merkle::hash_t append(const std::vector<uint8_t> *blob);
   void init(MDB_txn *append_tx);
 
+  /**
+   * Returns index of the last appended transaction (ledger height).
+   */
+  size_t height() const;
+
+  /**
+   * Returns index of the last committed transaction. May be called from any
+   * thread.
+   */
+  size_t committed_height() const;
+
+  /**
+   * Record \p order, consensus order of the last decided event, in the
+   * append transaction, so it is committed together with its transactions.
+   */
+  void set_order(uint64_t order);
+
+  /**
+   * Returns consensus order of the last committed decision, 0 if there is
+   * none. May be called from any thread.
+   */
+  uint64_t committed_order() const;
+
+  /**
+   * Open cold tier of the store in \p folder. Must be called before init().
+   */
+  void open_segments(const std::string &folder);
+
+  /**
+   * Move committed transactions up to \p upto from LMDB to a new segment
+   * file. Records are written to the segment and synced first, then deleted
+   * in the append transaction, so they are removed from LMDB on commit.
+   * Indexes keep pointing to archived transactions, reads fall back to
+   * segments.
+   * @return index of the last archived transaction
+   */
+  size_t archive(size_t upto, MDB_env *env);
+
+  /**
+   * Copy committed merkle tree frontier and metadata, visible in \p from, to
+   * \p to. Transactions are not copied: store opened on \p to continues
+   * from the committed height.
+   */
+  SnapshotInfo snapshot(MDB_txn *from, MDB_txn *to);
+
   /**
    * Close every cursor used in tx_store
    */
@@ -67,7 +189,25 @@ class TxStore {
    */
   uint32_t get_trees_total();
 
+  /**
+   * Returns true if new transactions are stored compressed.
+   */
+  bool compressed() const;
+
+  /**
+   * Store \p data in blob_store in the append transaction, keyed by its
+   * sha3_256. Blob, which is already stored, is not written again.
+   * @return digest of \p data
+   */
+  merkle::hash_t putBlob(const uint8_t *data, size_t size);
+
   // TxStore queries:
+  /**
+   * Returns blob with \p digest, data is nullptr if there is no such blob.
+   */
+  AM_val getBlob(const merkle::hash_t &digest, bool uncommitted = true,
+                 MDB_env *env = nullptr);
+
   AM_val getTransaction(size_t index, bool uncommitted = true, MDB_env *env = nullptr);
 
   std::vector<AM_val> getAssetTransferBySender(
@@ -83,11 +223,45 @@ class TxStore {
                                       bool uncommitted = true,
                                       MDB_env *env = nullptr);
 
+  /**
+   * Returns every transaction, which touches account with \p pubKey (as a
+   * creator, sender, receiver or target account), ordered by index.
+   */
+  std::vector<HistoryRecord> getAccountHistory(
+      const flatbuffers::String *pubKey, bool uncommitted = true,
+      MDB_env *env = nullptr);
+
+  /**
+   * Same as above, but only transactions with timestamp in [from, to].
+   * Indexes are taken from the timestamp index first, so transactions out of
+   * range are not read at all.
+   */
+  std::vector<HistoryRecord> getAccountHistory(
+      const flatbuffers::String *pubKey, uint64_t from, uint64_t to,
+      bool uncommitted = true, MDB_env *env = nullptr);
+
+  /**
+   * Returns sorted indexes of transactions with timestamp in [from, to].
+   */
+  std::vector<size_t> getTxIndexesByTime(uint64_t from, uint64_t to,
+                                         bool uncommitted = true,
+                                         MDB_env *env = nullptr);
+
+  /**
+   * Returns transactions with timestamp in [from, to], ordered by timestamp.
+   */
+  std::vector<AM_val> getTransactionsByTime(uint64_t from, uint64_t to,
+                                            bool uncommitted = true,
+                                            MDB_env *env = nullptr);
+
  private:
   size_t tx_store_total;
+  std::atomic<size_t> committed_total_{0};
+  std::atomic<uint64_t> committed_order_{0};
   std::unordered_map<std::string, std::pair<MDB_dbi, MDB_cursor *>> trees_;
   std::unordered_map<iroha::Command, std::string> command_tree_name_;
 
+  size_t merkle_leaves_;
   merkle::MerkleTree merkleTree_;
 
   MDB_txn *append_tx_;
@@ -97,6 +271,68 @@ class TxStore {
                                const flatbuffers::String *acc_pub_key,
                                size_t &tx_store_total);
 
+  void put_tx_into_history(const iroha::Transaction *tx);
+
+  /**
+   * Read transaction by index. Compressed transaction is decompressed into
+   * the buffer owned by the result, committed ones are also kept in LRU
+   * cache of AMETSUCHI_TX_CACHE_SIZE transactions. Eviction from the cache
+   * does not free buffers, which are still referenced by results.
+   */
+  AM_val read_tx(MDB_cursor *tx_cursor, size_t index,
+                 bool uncommitted = false);
+
+  // archived transactions, nullptr if there is no cold tier
+  std::unique_ptr<SegmentStore> segments_;
+
+  // compression of stored transactions
+  int compression_level_;
+  ZSTD_CCtx_s *cctx_ = nullptr;
+  ZSTD_DCtx_s *dctx_ = nullptr;
+  ZSTD_CDict_s *cdict_ = nullptr;
+  ZSTD_DDict_s *ddict_ = nullptr;
+  std::vector<uint8_t> dict_;
+  std::vector<uint8_t> samples_;
+  std::vector<size_t> sample_sizes_;
+  std::vector<uint8_t> compressed_;
+
+  // decompressed committed transactions, index => blob, LRU order
+  std::mutex cache_mutex_;
+  std::list<size_t> cache_order_;
+  std::unordered_map<size_t,
+                     std::pair<std::shared_ptr<const std::vector<uint8_t>>,
+                               std::list<size_t>::iterator>>
+      cache_;
+
+  /**
+   * Returns blob, which should be stored for transaction \p blob: compressed
+   * one if dictionary is trained and compression pays off, otherwise \p blob
+   */
+  MDB_val compress(const std::vector<uint8_t> *blob);
+  std::shared_ptr<const std::vector<uint8_t>> decompress(const MDB_val &val,
+                                                        size_t index,
+                                                        bool uncommitted);
+
+  // read dictionary from tx_store_meta, if it is trained
+  void load_dictionary();
+  // train dictionary from samples, if there are enough of them
+  void train_dictionary();
+  void free_dictionary();
+
+  // read committed consensus order from tx_store_meta
+  void load_order();
+
+  void put_tx_into_time_index(const iroha::Transaction *tx);
+
+  // walk over time index in [from, to], call f(index) for each transaction
+  void walk_time_index(MDB_cursor *cursor, uint64_t from, uint64_t to,
+                       const std::function<void(size_t)> &f);
+
+  // if indexes is not null, only transactions from sorted indexes are read
+  std::vector<HistoryRecord> account_history(
+      const flatbuffers::String *pubKey, const std::vector<size_t> *indexes,
+      bool uncommitted, MDB_env *env);
+
   void create_new_tree(MDB_txn *append_tx, const std::string &name,
                        uint32_t flags, MDB_cmp_func *dupsort = nullptr);
 
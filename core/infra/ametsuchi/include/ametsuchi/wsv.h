@@ -24,6 +24,7 @@
 #include <commands_generated.h>
 #include <flatbuffers/flatbuffers.h>
 #include <lmdb.h>
+#include <map>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -31,15 +32,59 @@
 
 namespace ametsuchi {
 
+/**
+ * Aggregates of created asset, maintained on every add/subtract/transfer.
+ * total_supply is raw amount with asset's precision.
+ */
+struct AssetStats {
+  __int128_t total_supply;
+  uint64_t holders;  // accounts with non-zero balance
+  uint8_t precision;
+};
+
 class WSV {
  public:
   WSV();
   ~WSV();
 
-  void update(const std::vector<uint8_t> *blob);
+  /**
+   * Apply transaction to the world state.
+   * @param height - index of the transaction in TX store, balances changed by
+   * the transaction are versioned with it
+   */
+  void update(const std::vector<uint8_t> *blob, size_t height);
 
   void init(MDB_txn *append_tx);
 
+  /**
+   * Restrict this WSV to one partition of the world state.
+   * Accounts (and their assets) are written only by the partition they belong
+   * to, peers are written only by partition 0, created assets are written by
+   * every partition.
+   * @param index - index of this partition
+   * @param total - total number of partitions
+   */
+  void set_partition(size_t index, size_t total);
+
+  /**
+   * Returns index of the partition, which stores account with \p pubKey.
+   * Stable between runs, so it may be used to place data on disk.
+   */
+  static size_t partition_of(const flatbuffers::String *pubKey, size_t total);
+
+  /**
+   * Write balances changed since last flush to the append transaction.
+   * Must be called before the append transaction is committed.
+   */
+  void flush();
+
+  /**
+   * Copy committed world state, visible in \p from, to \p to. Trees are
+   * created in \p to and filled in key order, so their pages are compact.
+   * Must be called after init().
+   */
+  void copy(MDB_txn *from, MDB_txn *to);
+
   /**
    * Close every cursor used in wsv
    */
@@ -52,6 +97,8 @@ class WSV {
 
 
   // WSV queries:
+  // Missing records are not errors: queries return nullptr or empty vector,
+  // exceptions are thrown only if LMDB fails.
   ::iroha::Asset *accountGetAsset(const flatbuffers::String *pubKey,
                                         const flatbuffers::String *ledger_name,
                                         const flatbuffers::String *domain_name,
@@ -72,6 +119,23 @@ class WSV {
                                      bool uncommitted = false,
                                      MDB_env *env = nullptr);
 
+  /**
+   * Returns account's asset as it was after transaction \p height was
+   * applied, O(log n) lookup in wsv_balance_history.
+   * @return nullptr if account had no such asset at that height
+   */
+  ::iroha::Asset *accountGetAssetAt(const flatbuffers::String *pubKey,
+                                    const flatbuffers::String *ledger_name,
+                                    const flatbuffers::String *domain_name,
+                                    const flatbuffers::String *asset_name,
+                                    size_t height, bool uncommitted = false,
+                                    MDB_env *env = nullptr);
+
+  // asset_id is ledger_name + domain_name + asset_name
+  // returns zero stats if asset is not created
+  AssetStats assetGetStats(const std::string &assetid,
+                           bool uncommitted = false, MDB_env *env = nullptr);
+
   const ::iroha::AccountPermissionRoot accountGetPermissionRoot(const flatbuffers::String *pubKey);
   const std::vector<const ::iroha::AccountPermissionLedger*> accountGetPermissionLedger(const flatbuffers::String *pubKey);
   const std::vector<const ::iroha::AccountPermissionDomain*> accountGetPermissionDomain(const flatbuffers::String *pubKey);
@@ -88,11 +152,88 @@ class WSV {
 
   uint32_t wsv_trees_total;
 
+  size_t partition_index_ = 0;
+  size_t partition_total_ = 1;
+
+  // height of the transaction being applied
+  size_t height_ = 0;
+
+  bool owns(const flatbuffers::String *pubKey) const;
+
   // [ledger+domain+asset] => ComplexAsset/Currency flatbuffer (without amount)
   std::unordered_map<std::string, std::vector<uint8_t>> created_assets_;
 
+  // account's currency, cached during the append transaction
+  struct Balance {
+    std::string pubkey;
+    std::string currency_name;
+    std::string domain_name;
+    std::string ledger_name;
+    std::string description;
+    __int128_t amount;
+    uint8_t precision;
+    bool stored;  // record exists in wsv_pubkey_assets
+    bool dirty;   // amount differs from the stored one
+    // height => amount after the transaction, not written to history yet
+    std::map<size_t, __int128_t> history;
+  };
+
+  // [pubkey+ledger+domain+asset] => balance. Add/subtract/transfer change
+  // only this map, balances are written to the tree once per flush.
+  std::unordered_map<std::string, Balance> balances_;
+
+  // [ledger+domain+asset] => aggregates changed during the append transaction
+  struct CachedStats {
+    __int128_t total_supply;
+    int64_t holders;
+    bool dirty;
+  };
+  std::unordered_map<std::string, CachedStats> stats_;
+
+  /**
+   * Returns cached aggregates of the asset, reads them on miss.
+   */
+  CachedStats &get_stats(const std::string &assetid);
+
+  /**
+   * Account's balance changed from \p before to balance.amount, update
+   * aggregates of its asset.
+   */
+  void update_stats(const Balance &balance, __int128_t before);
+
+  /**
+   * Returns cached balance of the account, reads it from the tree on miss.
+   * @throw ASSET_NOT_FOUND if account has no such currency and \p create is
+   * false
+   */
+  Balance &get_balance(const flatbuffers::String *acc_pub_key,
+                       const iroha::Currency *currency, bool create);
+
+  ::iroha::Asset *read_account_asset(const flatbuffers::String *pubKey,
+                                     const flatbuffers::String *ledger_name,
+                                     const flatbuffers::String *domain_name,
+                                     const flatbuffers::String *asset_name,
+                                     bool uncommitted, MDB_env *env);
+
   void read_created_assets();
 
+  /**
+   * Write version of account's balance to wsv_balance_history.
+   * Key is pubkey\0ledger+domain+asset\0height (big endian), so versions of
+   * one balance are adjacent and sorted by height. Removed balance is stored
+   * as empty value.
+   */
+  void put_balance_history(const Balance &balance, size_t height,
+                           __int128_t amount, bool removed = false);
+
+  static std::string balance_history_key(const std::string &pubkey,
+                                         const std::string &assetid,
+                                         size_t height);
+
+  static flatbuffers::Offset<iroha::Asset> create_currency(
+      flatbuffers::FlatBufferBuilder &fbb, const Balance &balance,
+      __int128_t amount);
+
   // WSV commands:
   // Use for operate Asset.
   void add(const iroha::Add *command);
@@ -17,6 +17,10 @@
 
 #include <ametsuchi/ametsuchi.h>
 #include <transaction_generated.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 
 // static auto console = spdlog::stdout_color_mt("ametsuchi");
@@ -25,8 +29,12 @@
 namespace ametsuchi {
 
 
-Ametsuchi::Ametsuchi(const std::string &db_folder)
-    : path_(db_folder), tx_store(AMETSUCHI_BLOCK_SIZE), wsv() {
+Ametsuchi::Ametsuchi(const std::string &db_folder, size_t wsv_shards,
+                     int tx_compression_level)
+    : path_(db_folder),
+      tx_store(AMETSUCHI_BLOCK_SIZE, tx_compression_level),
+      wsv(),
+      wsv_shards_(wsv_shards) {
   // initialize database:
   // create folder, create all handles and btrees
   // in case of any errors print error to stdout and exit
@@ -35,6 +43,7 @@ Ametsuchi::Ametsuchi(const std::string &db_folder)
 
 
 Ametsuchi::~Ametsuchi() {
+  shards_.reset();
   abort_append_tx();
 
   tx_store.close_dbi(env);
@@ -47,12 +56,26 @@ merkle::hash_t Ametsuchi::append(const std::vector<uint8_t> *blob) {
   // 1. Append to TX_store
   auto mt_root = tx_store.append(blob);
   // 2. Update WSV
-  wsv.update(blob);
+  if (shards_) {
+    shards_->update(blob, tx_store.height());
+  } else {
+    wsv.update(blob, tx_store.height());
+  }
   return mt_root;
 }
 
 merkle::hash_t Ametsuchi::append(
     const std::vector<std::vector<uint8_t> *> &batch) {
+  if (shards_) {
+    // shards apply the whole batch in parallel, wait only once
+    auto height = tx_store.height() + 1;
+    for (auto t : batch) {
+      tx_store.append(t);
+    }
+    shards_->update(batch, height);
+    return tx_store.merkle_root();
+  }
+
   for (auto t : batch) {
     append(t);
   }
@@ -62,89 +85,218 @@ merkle::hash_t Ametsuchi::append(
 
 
 void Ametsuchi::commit() {
+  std::lock_guard<std::mutex> lock(commit_mutex_);
   // commit merkle tree
   tx_store.commit();
+  // write cached balances
+  wsv.flush();
   // commit old transaction
   tx_store.close_cursors();
   wsv.close_cursors();
   mdb_txn_commit(append_tx_);
   mdb_env_stat(env, &mst);
 
+  // TX store is committed first: if shards are not committed because of
+  // crash, they are behind TX store and replayed on open (see replay_shards)
+  if (shards_) {
+    shards_->commit();
+  }
+
   // create new append transaction
   init_append_tx();
 }
 
 
-void Ametsuchi::rollback() {
-  abort_append_tx();
-  init_append_tx();
+size_t Ametsuchi::archive(size_t upto) {
+  // archive is committed, it must not commit transactions appended by the
+  // caller as a side effect
+  if (height(true) != height(false)) {
+    console->error("can not archive: transactions {}..{} are not committed",
+                   height(false) + 1, height(true));
+    throw exception::InternalError::UNCOMMITTED;
+  }
+  auto archived = tx_store.archive(upto, env);
+  // archived records are deleted in the append transaction
+  commit();
+  return archived;
 }
 
 
-void Ametsuchi::abort_append_tx() {
-  tx_store.close_cursors();
-  wsv.close_cursors();
-  if (append_tx_) mdb_txn_abort(append_tx_);
+// folder path without trailing slashes, to be renamed
+static std::string folder_name(std::string folder) {
+  while (folder.size() > 1 && folder.back() == '/') {
+    folder.pop_back();
+  }
+  return folder;
 }
 
 
-void Ametsuchi::init() {
+SnapshotInfo Ametsuchi::exportSnapshot(const std::string &folder) {
+  auto target = folder_name(folder);
+  auto tmp = target + ".tmp";
+  remove_folder(tmp);
+
+  std::lock_guard<std::mutex> lock(commit_mutex_);
+  auto snapshot_env = init_env(tmp + "/", AMETSUCHI_TREES_TOTAL);
+  MDB_txn *from, *to;
   int res;
+  if ((res = mdb_txn_begin(env, nullptr, MDB_RDONLY, &from)) != 0) {
+    AMETSUCHI_CRITICAL(res, MDB_PANIC);
+    AMETSUCHI_CRITICAL(res, MDB_MAP_RESIZED);
+    AMETSUCHI_CRITICAL(res, MDB_READERS_FULL);
+    AMETSUCHI_CRITICAL(res, ENOMEM);
+  }
+  if ((res = mdb_txn_begin(snapshot_env, nullptr, 0, &to)) != 0) {
+    AMETSUCHI_CRITICAL(res, MDB_PANIC);
+    AMETSUCHI_CRITICAL(res, MDB_MAP_RESIZED);
+    AMETSUCHI_CRITICAL(res, MDB_READERS_FULL);
+    AMETSUCHI_CRITICAL(res, ENOMEM);
+  }
 
-  // create database directory
-  if ((res = mkdir(path_.c_str(), 0700))) {
-    if (res == EEXIST) {
-      console->debug("folder with database exists");
-    } else {
-      AMETSUCHI_CRITICAL(res, EACCES);
-      AMETSUCHI_CRITICAL(res, ELOOP);
-      AMETSUCHI_CRITICAL(res, EMLINK);
-      AMETSUCHI_CRITICAL(res, ENAMETOOLONG);
-      AMETSUCHI_CRITICAL(res, ENOENT);
-      AMETSUCHI_CRITICAL(res, ENOSPC);
-      AMETSUCHI_CRITICAL(res, ENOTDIR);
-      AMETSUCHI_CRITICAL(res, EROFS);
-    }
+  // both stores read the same committed state of one RO transaction
+  wsv.copy(from, to);
+  auto info = tx_store.snapshot(from, to);
+  mdb_txn_abort(from);
+  if ((res = mdb_txn_commit(to)) != 0) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+    AMETSUCHI_CRITICAL(res, ENOSPC);
+    AMETSUCHI_CRITICAL(res, EIO);
+    AMETSUCHI_CRITICAL(res, ENOMEM);
   }
+  mdb_env_close(snapshot_env);
+  std::remove((tmp + "/lock.mdb").c_str());
 
-  // create environment
-  if ((res = mdb_env_create(&env))) {
-    AMETSUCHI_CRITICAL(res, MDB_VERSION_MISMATCH);
-    AMETSUCHI_CRITICAL(res, MDB_INVALID);
-    AMETSUCHI_CRITICAL(res, ENOENT);
-    AMETSUCHI_CRITICAL(res, EACCES);
-    AMETSUCHI_CRITICAL(res, EAGAIN);
+  // commit waits for the copy, shards are at the height of TX store
+  if (shards_) {
+    shards_->snapshot(tmp);
   }
 
-  // set maximum mmap size. Must be multiple of OS page size (4 KB).
-  // max size of the database (!!!)
-  if ((res = mdb_env_set_mapsize(env, AMETSUCHI_MAX_DB_SIZE))) {
-    AMETSUCHI_CRITICAL(res, EINVAL);
+  remove_folder(target);
+  if (std::rename(tmp.c_str(), target.c_str()) != 0) {
+    console->critical("can not rename {}: {}", tmp, std::strerror(errno));
+    throw exception::InternalError::FATAL;
   }
+  return info;
+}
 
-  AMETSUCHI_TREES_TOTAL = wsv.get_trees_total() + tx_store.get_trees_total();
-  // set number of databases in single file
-  if ((res = mdb_env_set_maxdbs(env, AMETSUCHI_TREES_TOTAL))) {
-    AMETSUCHI_CRITICAL(res, EINVAL);
+
+void Ametsuchi::installSnapshot(const std::string &snapshot_folder,
+                                const std::string &db_folder) {
+  auto snapshot = folder_name(snapshot_folder);
+  auto db = folder_name(db_folder);
+  auto old = db + ".old";
+
+  struct stat st;
+  if (stat((snapshot + "/data.mdb").c_str(), &st) != 0) {
+    console->critical("{} is not a snapshot", snapshot);
+    throw exception::InternalError::FATAL;
+  }
+
+  // database is either the previous one or the snapshot, if rename of the
+  // snapshot fails, previous database stays in <db_folder>.old
+  remove_folder(old);
+  if (stat(db.c_str(), &st) == 0 && std::rename(db.c_str(), old.c_str()) != 0) {
+    console->critical("can not rename {}: {}", db, std::strerror(errno));
+    throw exception::InternalError::FATAL;
+  }
+  if (std::rename(snapshot.c_str(), db.c_str()) != 0) {
+    console->critical("can not rename {}: {}", snapshot, std::strerror(errno));
+    throw exception::InternalError::FATAL;
   }
+  remove_folder(old);
+}
+
+
+size_t Ametsuchi::height(bool uncommitted) {
+  return uncommitted ? tx_store.height() : tx_store.committed_height();
+}
+
+
+void Ametsuchi::setOrder(uint64_t order) { tx_store.set_order(order); }
+
+
+uint64_t Ametsuchi::order() { return tx_store.committed_order(); }
+
+
+merkle::hash_t Ametsuchi::putAttachment(const std::vector<uint8_t> &data) {
+  return tx_store.putBlob(data.data(), data.size());
+}
+
+
+AM_val Ametsuchi::getAttachment(const merkle::hash_t &digest,
+                                bool uncommitted) {
+  return tx_store.getBlob(digest, uncommitted, env);
+}
+
+
+void Ametsuchi::rollback() {
+  abort_append_tx();
+  init_append_tx();
+  // in-memory merkle tree has appended leaves, restore committed one
+  tx_store.init_merkle_tree();
 
-  // create database environment
-  if ((res = mdb_env_open(env, path_.c_str(), MDB_FIXEDMAP, 0700))) {
-    AMETSUCHI_CRITICAL(res, MDB_VERSION_MISMATCH);
-    AMETSUCHI_CRITICAL(res, MDB_INVALID);
-    AMETSUCHI_CRITICAL(res, ENOENT);
-    AMETSUCHI_CRITICAL(res, EACCES);
-    AMETSUCHI_CRITICAL(res, EAGAIN);
-    AMETSUCHI_CRITICAL(res, EBUSY);
+  if (shards_) {
+    shards_->rollback();
   }
+}
+
+
+void Ametsuchi::abort_append_tx() {
+  tx_store.close_cursors();
+  wsv.close_cursors();
+  if (append_tx_) mdb_txn_abort(append_tx_);
+}
+
+
+void Ametsuchi::init() {
+  AMETSUCHI_TREES_TOTAL = wsv.get_trees_total() + tx_store.get_trees_total();
+  env = init_env(path_, AMETSUCHI_TREES_TOTAL);
 
   // stats about db
   mdb_env_stat(env, &mst);
 
+  // cold tier must be opened before TX store counts transactions
+  tx_store.open_segments(path_ + (path_.back() == '/' ? "" : "/") +
+                         "segments/");
+
   // initialize
   init_append_tx();
 
   tx_store.init_merkle_tree();
+
+  if (wsv_shards_ > 1) {
+    shards_.reset(new ShardedWSV(path_, wsv_shards_));
+    replay_shards();
+  }
+}
+
+
+void Ametsuchi::replay_shards() {
+  auto committed = tx_store.committed_height();
+  bool behind = false;
+  for (size_t i = 0; i < shards_->size(); i++) {
+    auto height = shards_->committed_height(i);
+    if (height > committed) {
+      console->critical("WSV shard {} is at {}, TX store is at {}", i, height,
+                        committed);
+      throw exception::InternalError::FATAL;
+    }
+    if (height == committed) continue;
+
+    console->warn("replaying transactions {}..{} to WSV shard {}", height + 1,
+                  committed, i);
+    behind = true;
+    std::vector<uint8_t> blob;
+    for (auto index = height + 1; index <= committed; index++) {
+      auto tx = tx_store.getTransaction(index, false, env);
+      auto data = static_cast<const uint8_t *>(tx.data);
+      blob.assign(data, data + tx.size);
+      shards_->update(i, &blob, index);
+    }
+  }
+  if (behind) {
+    shards_->commit();
+  }
 }
 
 
@@ -166,14 +318,23 @@ void Ametsuchi::init_append_tx() {
   mdb_env_stat(env, &mst);
 }
 
-const ::iroha::Transaction *Ametsuchi::getTransaction(size_t index,
-                                                      bool uncommitted) {
-  return flatbuffers::GetRoot<iroha::Transaction>(
-      tx_store.getTransaction(index, uncommitted, env).data);
+std::shared_ptr<const ::iroha::Transaction> Ametsuchi::getTransaction(
+    size_t index, bool uncommitted) {
+  auto tx = tx_store.getTransaction(index, uncommitted, env);
+  // aliasing pointer: shares ownership of the buffer, points to the root
+  return std::shared_ptr<const ::iroha::Transaction>(
+      tx.owner, flatbuffers::GetRoot<iroha::Transaction>(tx.data));
 }
 
 std::vector<const ::iroha::Asset *> Ametsuchi::accountGetAllAssets(
     const flatbuffers::String *pubKey, bool uncommitted) {
+  if (shards_) {
+    return shards_->run(shards_->shard_of(pubKey),
+                        [&](WSV &shard, MDB_env *shard_env) {
+                          return shard.accountGetAllAssets(pubKey, uncommitted,
+                                                           shard_env);
+                        });
+  }
   return wsv.accountGetAllAssets(pubKey, uncommitted, env);
 }
 
@@ -182,34 +343,108 @@ const ::iroha::Asset *Ametsuchi::accountGetAsset(
     const flatbuffers::String *pubKey, const flatbuffers::String *ledger_name,
     const flatbuffers::String *domain_name,
     const flatbuffers::String *asset_name, bool uncommitted) {
+  if (shards_) {
+    return shards_->run(shards_->shard_of(pubKey),
+                        [&](WSV &shard, MDB_env *shard_env) {
+                          return shard.accountGetAsset(
+                              pubKey, ledger_name, domain_name, asset_name,
+                              uncommitted, shard_env);
+                        });
+  }
   return wsv.accountGetAsset(pubKey, ledger_name, domain_name, asset_name,
                              uncommitted, env);
 }
 
 
+const ::iroha::Asset *Ametsuchi::accountGetAssetAt(
+    const flatbuffers::String *pubKey, const flatbuffers::String *ledger_name,
+    const flatbuffers::String *domain_name,
+    const flatbuffers::String *asset_name, size_t height, bool uncommitted) {
+  if (shards_) {
+    return shards_->run(shards_->shard_of(pubKey),
+                        [&](WSV &shard, MDB_env *shard_env) {
+                          return shard.accountGetAssetAt(
+                              pubKey, ledger_name, domain_name, asset_name,
+                              height, uncommitted, shard_env);
+                        });
+  }
+  return wsv.accountGetAssetAt(pubKey, ledger_name, domain_name, asset_name,
+                               height, uncommitted, env);
+}
+
+
 const ::iroha::Asset *Ametsuchi::assetidGetAsset(
     const std::string &&ledger_name, const std::string &&domain_name,
     const std::string &&asset_name, bool uncommitted) {
+  if (shards_) {
+    // every shard knows all created assets
+    return shards_->run(0, [&](WSV &shard, MDB_env *shard_env) {
+      return shard.assetidGetAsset(asset_name + domain_name + ledger_name,
+                                   uncommitted, shard_env);
+    });
+  }
   return wsv.assetidGetAsset(asset_name + domain_name + ledger_name,
                              uncommitted, env);
 }
 
+AssetStats Ametsuchi::assetGetStats(const std::string &ledger_name,
+                                    const std::string &domain_name,
+                                    const std::string &asset_name,
+                                    bool uncommitted) {
+  auto assetid = ledger_name + domain_name + asset_name;
+  if (shards_) {
+    // every shard keeps aggregates of accounts it owns
+    AssetStats ret{0, 0, 0};
+    for (size_t i = 0; i < shards_->size(); i++) {
+      auto stats = shards_->run(i, [&](WSV &shard, MDB_env *shard_env) {
+        return shard.assetGetStats(assetid, uncommitted, shard_env);
+      });
+      ret.total_supply += stats.total_supply;
+      ret.holders += stats.holders;
+      ret.precision = stats.precision;
+    }
+    return ret;
+  }
+  return wsv.assetGetStats(assetid, uncommitted, env);
+}
+
 const std::vector<const ::iroha::AccountPermissionLedger *>
 Ametsuchi::assetGetPermissionLedger(const flatbuffers::String *pubKey) {
+  if (shards_) {
+    return shards_->run(shards_->shard_of(pubKey), [&](WSV &shard, MDB_env *) {
+      return shard.accountGetPermissionLedger(pubKey);
+    });
+  }
   return wsv.accountGetPermissionLedger(pubKey);
 }
 const std::vector<const ::iroha::AccountPermissionDomain *>
 Ametsuchi::assetGetPermissionDomain(const flatbuffers::String *pubKey) {
+  if (shards_) {
+    return shards_->run(shards_->shard_of(pubKey), [&](WSV &shard, MDB_env *) {
+      return shard.accountGetPermissionDomain(pubKey);
+    });
+  }
   return wsv.accountGetPermissionDomain(pubKey);
 }
 const std::vector<const ::iroha::AccountPermissionAsset *>
 Ametsuchi::assetGetPermissionAsset(const flatbuffers::String *pubKey) {
+  if (shards_) {
+    return shards_->run(shards_->shard_of(pubKey), [&](WSV &shard, MDB_env *) {
+      return shard.accountGetPermissionAsset(pubKey);
+    });
+  }
   return wsv.accountGetPermissionAsset(pubKey);
 }
 
 
 const ::iroha::Peer *Ametsuchi::pubKeyGetPeer(const flatbuffers::String *pubKey,
                                               bool uncommitted) {
+  if (shards_) {
+    // peers are stored in the first shard
+    return shards_->run(0, [&](WSV &shard, MDB_env *shard_env) {
+      return shard.pubKeyGetPeer(pubKey, uncommitted, shard_env);
+    });
+  }
   return wsv.pubKeyGetPeer(pubKey, uncommitted, env);
 }
 
@@ -230,6 +465,23 @@ std::vector<AM_val> Ametsuchi::getCommandByKey(
   return tx_store.getCommandByKey(pubKey, command, uncommitted);
 }
 
+std::vector<HistoryRecord> Ametsuchi::getAccountHistory(
+    const flatbuffers::String *pubKey, bool uncommitted) {
+  return tx_store.getAccountHistory(pubKey, uncommitted, env);
+}
+
+std::vector<HistoryRecord> Ametsuchi::getAccountHistory(
+    const flatbuffers::String *pubKey, uint64_t from, uint64_t to,
+    bool uncommitted) {
+  return tx_store.getAccountHistory(pubKey, from, to, uncommitted, env);
+}
+
+std::vector<AM_val> Ametsuchi::getTransactionsByTime(uint64_t from,
+                                                     uint64_t to,
+                                                     bool uncommitted) {
+  return tx_store.getTransactionsByTime(from, to, uncommitted, env);
+}
+
 const std::string Ametsuchi::getMerkleRoot() {
   if (tx_store.merkle_root().empty()) {
     return "";
@@ -238,4 +490,12 @@ const std::string Ametsuchi::getMerkleRoot() {
 }
 
 
+const std::string Ametsuchi::getMerkleRoot(size_t height) {
+  merkle::hash_t root;
+  if (!tx_store.merkle_root(height, root, env)) {
+    return "";
+  }
+  return std::string(root.begin(), root.end());
+}
+
 }  // namespace ametsuchi
@@ -16,7 +16,77 @@
  */
 
 #include <ametsuchi/common.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 
 namespace ametsuchi {
 std::shared_ptr<spdlog::logger> console = spdlog::stdout_color_mt("ametsuchi");
+
+MDB_env *init_env(const std::string &path, uint32_t trees_total) {
+  MDB_env *env;
+  int res;
+
+  // create database directory
+  if ((res = mkdir(path.c_str(), 0700))) {
+    if (res == EEXIST) {
+      console->debug("folder with database exists");
+    } else {
+      AMETSUCHI_CRITICAL(res, EACCES);
+      AMETSUCHI_CRITICAL(res, ELOOP);
+      AMETSUCHI_CRITICAL(res, EMLINK);
+      AMETSUCHI_CRITICAL(res, ENAMETOOLONG);
+      AMETSUCHI_CRITICAL(res, ENOENT);
+      AMETSUCHI_CRITICAL(res, ENOSPC);
+      AMETSUCHI_CRITICAL(res, ENOTDIR);
+      AMETSUCHI_CRITICAL(res, EROFS);
+    }
+  }
+
+  // create environment
+  if ((res = mdb_env_create(&env))) {
+    AMETSUCHI_CRITICAL(res, MDB_VERSION_MISMATCH);
+    AMETSUCHI_CRITICAL(res, MDB_INVALID);
+    AMETSUCHI_CRITICAL(res, ENOENT);
+    AMETSUCHI_CRITICAL(res, EACCES);
+    AMETSUCHI_CRITICAL(res, EAGAIN);
+  }
+
+  // set maximum mmap size. Must be multiple of OS page size (4 KB).
+  // max size of the database (!!!)
+  if ((res = mdb_env_set_mapsize(env, AMETSUCHI_MAX_DB_SIZE))) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  // set number of databases in single file
+  if ((res = mdb_env_set_maxdbs(env, trees_total))) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  // create database environment
+  if ((res = mdb_env_open(env, path.c_str(), MDB_FIXEDMAP, 0700))) {
+    AMETSUCHI_CRITICAL(res, MDB_VERSION_MISMATCH);
+    AMETSUCHI_CRITICAL(res, MDB_INVALID);
+    AMETSUCHI_CRITICAL(res, ENOENT);
+    AMETSUCHI_CRITICAL(res, EACCES);
+    AMETSUCHI_CRITICAL(res, EAGAIN);
+    AMETSUCHI_CRITICAL(res, EBUSY);
+  }
+
+  return env;
+}
+
+
+void remove_folder(const std::string &path) {
+  auto remove_entry = [](const char *entry, const struct stat *, int,
+                         struct FTW *) { return std::remove(entry); };
+  // children are visited before their folder
+  if (nftw(path.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS) != 0 &&
+      errno != ENOENT) {
+    console->critical("can not remove {}: {}", path, std::strerror(errno));
+    throw exception::InternalError::FATAL;
+  }
+}
 }
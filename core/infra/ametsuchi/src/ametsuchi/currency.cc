@@ -59,6 +59,7 @@ std::string Currency::to_string() {
 }
 std::string Currency::to_string(__int128_t x){
   std::string res = "";
+  if( x == 0 ) return "0";
   bool mf = (x<0);
   while( x ) {
     res += (char)((x%10)+'0');
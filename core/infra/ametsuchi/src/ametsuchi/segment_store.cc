@@ -0,0 +1,216 @@
+/**
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ametsuchi/segment_store.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace ametsuchi {
+
+static const char SEGMENT_MAGIC[4] = {'A', 'M', 'S', 'G'};
+static const size_t SEGMENT_HEADER_SIZE =
+    sizeof(SEGMENT_MAGIC) + sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+// records and sparse index are 8-byte aligned to be read in place
+static size_t aligned(size_t size) {
+  return (size + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+}
+
+#define AMETSUCHI_SEGMENT_CRITICAL(cond, path)                            \
+  if (cond) {                                                             \
+    console->critical("segment {}: {}", path, std::strerror(errno));      \
+    console->critical("err in {} at #{} in file {}", __PRETTY_FUNCTION__, \
+                      __LINE__, __FILE__);                                \
+    throw exception::InternalError::FATAL;                                \
+  }
+
+SegmentStore::SegmentStore(const std::string &folder) : folder_(folder) {
+  if (folder_.empty() || folder_.back() != '/') {
+    folder_ += '/';
+  }
+
+  AMETSUCHI_SEGMENT_CRITICAL(
+      mkdir(folder_.c_str(), 0700) != 0 && errno != EEXIST, folder_);
+
+  DIR *dir = opendir(folder_.c_str());
+  AMETSUCHI_SEGMENT_CRITICAL(dir == nullptr, folder_);
+  while (auto entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    // unfinished segments (*.tmp) are ignored, they are rewritten by archive
+    if (name.compare(0, 8, "segment_") == 0 && name.size() > 4 &&
+        name.compare(name.size() - 4, 4, ".dat") == 0) {
+      open(folder_ + name);
+    }
+  }
+  closedir(dir);
+
+  std::sort(segments_.begin(), segments_.end(),
+            [](const Segment &a, const Segment &b) { return a.first < b.first; });
+}
+
+
+SegmentStore::~SegmentStore() {
+  for (auto &&segment : segments_) {
+    munmap((void *)segment.data, segment.size);
+  }
+}
+
+
+void SegmentStore::open(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  AMETSUCHI_SEGMENT_CRITICAL(fd < 0, path);
+
+  struct stat st;
+  AMETSUCHI_SEGMENT_CRITICAL(fstat(fd, &st) != 0, path);
+
+  Segment segment;
+  segment.size = static_cast<size_t>(st.st_size);
+  if (segment.size < SEGMENT_HEADER_SIZE + sizeof(uint64_t)) {
+    console->critical("segment {} is corrupted", path);
+    throw exception::InternalError::FATAL;
+  }
+
+  auto data = mmap(nullptr, segment.size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  AMETSUCHI_SEGMENT_CRITICAL(data == MAP_FAILED, path);
+  segment.data = static_cast<const uint8_t *>(data);
+
+  if (std::memcmp(segment.data, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0) {
+    console->critical("segment {} is corrupted", path);
+    throw exception::InternalError::FATAL;
+  }
+
+  auto ptr = segment.data + sizeof(SEGMENT_MAGIC);
+  uint64_t first, count, index_offset;
+  std::memcpy(&segment.step, ptr, sizeof(uint32_t));
+  std::memcpy(&first, ptr + sizeof(uint32_t), sizeof(uint64_t));
+  std::memcpy(&count, ptr + sizeof(uint32_t) + sizeof(uint64_t),
+              sizeof(uint64_t));
+  std::memcpy(&index_offset, segment.data + segment.size - sizeof(uint64_t),
+              sizeof(uint64_t));
+  segment.first = first;
+  segment.count = count;
+  segment.sparse =
+      reinterpret_cast<const uint64_t *>(segment.data + index_offset);
+
+  segments_.push_back(segment);
+}
+
+
+void SegmentStore::write(size_t first, const std::vector<AM_val> &records) {
+  if (records.empty()) return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  // the first segment may start anywhere (e.g. after snapshot height)
+  auto expected = segments_.empty()
+                      ? first
+                      : segments_.back().first + segments_.back().count;
+  if (first != expected) {
+    console->critical("segment must start at {}, not at {}", expected,
+                      first);
+    throw exception::InternalError::FATAL;
+  }
+
+  char name[64];
+  std::snprintf(name, sizeof(name), "segment_%020zu.dat", first);
+  auto path = folder_ + name;
+  auto tmp_path = path + ".tmp";
+
+  FILE *file = std::fopen(tmp_path.c_str(), "wb");
+  AMETSUCHI_SEGMENT_CRITICAL(file == nullptr, tmp_path);
+
+  uint32_t step = AMETSUCHI_SEGMENT_INDEX_STEP;
+  uint64_t first64 = first, count = records.size();
+  std::vector<uint64_t> sparse;
+  uint64_t offset = SEGMENT_HEADER_SIZE;
+
+  bool ok = std::fwrite(SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC), 1, file) == 1 &&
+            std::fwrite(&step, sizeof(step), 1, file) == 1 &&
+            std::fwrite(&first64, sizeof(first64), 1, file) == 1 &&
+            std::fwrite(&count, sizeof(count), 1, file) == 1;
+
+  uint64_t zero = 0;
+  for (size_t i = 0; ok && i < records.size(); i++) {
+    if (i % step == 0) {
+      sparse.push_back(offset);
+    }
+    uint64_t size = records[i].size;
+    size_t padding = aligned(size) - size;
+    ok = std::fwrite(&size, sizeof(size), 1, file) == 1 &&
+         std::fwrite(records[i].data, 1, size, file) == size &&
+         std::fwrite(&zero, 1, padding, file) == padding;
+    offset += sizeof(size) + aligned(size);
+  }
+
+  uint64_t index_offset = offset;
+  ok = ok &&
+       std::fwrite(sparse.data(), sizeof(uint64_t), sparse.size(), file) ==
+           sparse.size() &&
+       std::fwrite(&index_offset, sizeof(index_offset), 1, file) == 1 &&
+       std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+  std::fclose(file);
+  AMETSUCHI_SEGMENT_CRITICAL(!ok, tmp_path);
+
+  // segment appears only when it is completely written
+  AMETSUCHI_SEGMENT_CRITICAL(std::rename(tmp_path.c_str(), path.c_str()) != 0,
+                             path);
+  int dir = ::open(folder_.c_str(), O_RDONLY);
+  if (dir >= 0) {
+    fsync(dir);
+    ::close(dir);
+  }
+
+  open(path);
+}
+
+
+bool SegmentStore::get(size_t index, MDB_val &val) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // the last segment, which starts before index
+  auto it = std::upper_bound(
+      segments_.begin(), segments_.end(), index,
+      [](size_t i, const Segment &segment) { return i < segment.first; });
+  if (it == segments_.begin()) return false;
+  --it;
+  if (index >= it->first + it->count) return false;
+
+  // jump by sparse index, then skip at most step - 1 records
+  auto k = index - it->first;
+  auto ptr = it->data + it->sparse[k / it->step];
+  for (size_t i = 0; i < k % it->step; i++) {
+    ptr += sizeof(uint64_t) + aligned(*reinterpret_cast<const uint64_t *>(ptr));
+  }
+
+  val.mv_data = (void *)(ptr + sizeof(uint64_t));
+  val.mv_size = *reinterpret_cast<const uint64_t *>(ptr);
+  return true;
+}
+
+
+size_t SegmentStore::last() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (segments_.empty()) return 0;
+  return segments_.back().first + segments_.back().count - 1;
+}
+
+}  // namespace ametsuchi
@@ -0,0 +1,282 @@
+/**
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ametsuchi/sharded_wsv.h>
+#include <transaction_generated.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+
+namespace ametsuchi {
+
+// key of the last applied transaction index in the shard meta tree
+static const std::string HEIGHT_KEY = "height";
+
+ShardedWSV::ShardedWSV(const std::string &db_folder, size_t shards) {
+  std::string folder = db_folder;
+  if (folder.empty() || folder.back() != '/') {
+    folder += '/';
+  }
+
+  for (size_t i = 0; i < shards; i++) {
+    std::unique_ptr<Shard> shard(new Shard());
+    shard->path = folder + "wsv_shard_" + std::to_string(i) + "/";
+    // one more tree for the shard meta
+    shard->env = init_env(shard->path, shard->wsv.get_trees_total() + 1);
+    shard->append_tx_ = nullptr;
+    shard->height = 0;
+    shard->committed_height = 0;
+    shard->stop = false;
+    shard->wsv.set_partition(i, shards);
+
+    auto &ref = *shard;
+    shard->writer = std::thread([this, &ref] { writer_loop(ref); });
+    shards_.push_back(std::move(shard));
+  }
+
+  // append transactions must be created by the writer threads
+  for_each([this](Shard &shard) { init_append_tx(shard); });
+}
+
+
+ShardedWSV::~ShardedWSV() {
+  for_each([this](Shard &shard) { abort_append_tx(shard); });
+
+  for (auto &&shard : shards_) {
+    {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      shard->stop = true;
+    }
+    shard->cv.notify_one();
+    shard->writer.join();
+
+    shard->wsv.close_dbi(shard->env);
+    mdb_env_close(shard->env);
+  }
+}
+
+
+void ShardedWSV::update(const std::vector<uint8_t> *blob, size_t height) {
+  // sender's shard fails an invalid transfer before receiver's shard credits
+  Shard *first = nullptr;
+  auto sender = debit_shard(blob);
+  if (sender != shards_.size()) {
+    update(sender, blob, height);
+    first = shards_[sender].get();
+  }
+  for_each([blob, height, first](Shard &shard) {
+    if (&shard == first) return;
+    shard.wsv.update(blob, height);
+    shard.height = height;
+  });
+}
+
+
+void ShardedWSV::update(const std::vector<std::vector<uint8_t> *> &batch,
+                        size_t height) {
+  // shards apply the batch independently, a transfer between them is
+  // applied transaction by transaction
+  for (auto t : batch) {
+    if (debit_shard(t) != shards_.size()) {
+      for (auto tx : batch) {
+        update(tx, height++);
+      }
+      return;
+    }
+  }
+
+  for_each([&batch, height](Shard &shard) {
+    auto h = height;
+    for (auto t : batch) {
+      shard.wsv.update(t, h);
+      shard.height = h++;
+    }
+  });
+}
+
+
+void ShardedWSV::update(size_t index, const std::vector<uint8_t> *blob,
+                        size_t height) {
+  auto &shard = *shards_.at(index);
+  submit(shard, [&shard, blob, height] {
+    shard.wsv.update(blob, height);
+    shard.height = height;
+  }).get();
+}
+
+
+size_t ShardedWSV::committed_height(size_t index) const {
+  return shards_.at(index)->committed_height;
+}
+
+
+void ShardedWSV::commit() {
+  for_each([this](Shard &shard) {
+    int res;
+    shard.wsv.flush();
+    shard.wsv.close_cursors();
+    // height is committed atomically with the data it describes
+    MDB_val c_key, c_val;
+    c_key.mv_data = (void *)HEIGHT_KEY.data();
+    c_key.mv_size = HEIGHT_KEY.size();
+    c_val.mv_data = &shard.height;
+    c_val.mv_size = sizeof(shard.height);
+    if ((res = mdb_put(shard.append_tx_, shard.meta, &c_key, &c_val, 0))) {
+      AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
+      AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+      AMETSUCHI_CRITICAL(res, EACCES);
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+    if ((res = mdb_txn_commit(shard.append_tx_))) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+      AMETSUCHI_CRITICAL(res, ENOSPC);
+      AMETSUCHI_CRITICAL(res, EIO);
+      AMETSUCHI_CRITICAL(res, ENOMEM);
+    }
+    shard.committed_height = shard.height;
+    init_append_tx(shard);
+  });
+}
+
+
+void ShardedWSV::snapshot(const std::string &db_folder) {
+  std::string folder = db_folder;
+  if (folder.empty() || folder.back() != '/') {
+    folder += '/';
+  }
+
+  // copy uses its own read-only transaction, so it does not wait for writers
+  for (size_t i = 0; i < shards_.size(); i++) {
+    auto path = folder + "wsv_shard_" + std::to_string(i) + "/";
+    if (mkdir(path.c_str(), 0700) != 0 && errno != EEXIST) {
+      console->critical("can not create {}: {}", path, std::strerror(errno));
+      throw exception::InternalError::FATAL;
+    }
+
+    int res;
+    if ((res = mdb_env_copy2(shards_[i]->env, path.c_str(), MDB_CP_COMPACT))) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+      AMETSUCHI_CRITICAL(res, EACCES);
+      AMETSUCHI_CRITICAL(res, ENOSPC);
+      AMETSUCHI_CRITICAL(res, EIO);
+    }
+  }
+}
+
+
+void ShardedWSV::rollback() {
+  for_each([this](Shard &shard) {
+    abort_append_tx(shard);
+    init_append_tx(shard);
+  });
+}
+
+
+size_t ShardedWSV::shard_of(const flatbuffers::String *pubKey) const {
+  return WSV::partition_of(pubKey, shards_.size());
+}
+
+
+size_t ShardedWSV::size() const { return shards_.size(); }
+
+
+size_t ShardedWSV::debit_shard(const std::vector<uint8_t> *blob) const {
+  auto tx = flatbuffers::GetRoot<iroha::Transaction>(blob->data());
+  if (tx->command_type() != iroha::Command::Transfer) return shards_.size();
+  auto transfer = tx->command_as_Transfer();
+  auto sender = shard_of(transfer->sender());
+  if (sender == shard_of(transfer->receiver())) return shards_.size();
+  return sender;
+}
+
+
+void ShardedWSV::for_each(const std::function<void(Shard &)> &f) {
+  std::vector<std::future<void>> futures;
+  for (auto &&shard : shards_) {
+    auto &ref = *shard;
+    futures.push_back(submit(ref, [&f, &ref] { f(ref); }));
+  }
+
+  // wait for every shard, even if some of them failed
+  std::exception_ptr error;
+  for (auto &&future : futures) {
+    try {
+      future.get();
+    } catch (...) {
+      if (!error) error = std::current_exception();
+    }
+  }
+  if (error) std::rethrow_exception(error);
+}
+
+
+void ShardedWSV::init_append_tx(Shard &shard) {
+  int res;
+
+  // begin "append" transaction
+  if ((res = mdb_txn_begin(shard.env, NULL, 0, &shard.append_tx_))) {
+    AMETSUCHI_CRITICAL(res, MDB_PANIC);
+    AMETSUCHI_CRITICAL(res, MDB_MAP_RESIZED);
+    AMETSUCHI_CRITICAL(res, MDB_READERS_FULL);
+    AMETSUCHI_CRITICAL(res, ENOMEM);
+  }
+  shard.wsv.init(shard.append_tx_);
+
+  if ((res = mdb_dbi_open(shard.append_tx_, "wsv_shard_meta", MDB_CREATE,
+                          &shard.meta))) {
+    AMETSUCHI_CRITICAL(res, MDB_NOTFOUND);
+    AMETSUCHI_CRITICAL(res, MDB_DBS_FULL);
+  }
+
+  // shard without height has not applied anything yet, it is replayed from
+  // the first transaction
+  MDB_val c_key, c_val;
+  c_key.mv_data = (void *)HEIGHT_KEY.data();
+  c_key.mv_size = HEIGHT_KEY.size();
+  if ((res = mdb_get(shard.append_tx_, shard.meta, &c_key, &c_val)) == 0) {
+    std::memcpy(&shard.committed_height, c_val.mv_data,
+                sizeof(shard.committed_height));
+  } else if (res != MDB_NOTFOUND) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+  shard.height = shard.committed_height;
+}
+
+
+void ShardedWSV::abort_append_tx(Shard &shard) {
+  shard.wsv.close_cursors();
+  if (shard.append_tx_) mdb_txn_abort(shard.append_tx_);
+  shard.append_tx_ = nullptr;
+}
+
+
+void ShardedWSV::writer_loop(Shard &shard) {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(shard.mutex);
+      shard.cv.wait(lock,
+                    [&shard] { return shard.stop || !shard.tasks.empty(); });
+      if (shard.tasks.empty()) return;
+      task = std::move(shard.tasks.front());
+      shard.tasks.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace ametsuchi
@@ -20,9 +20,20 @@
 #include <asset_generated.h>
 #include <transaction_generated.h>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include <zdict.h>
+#include <zstd.h>
 
 namespace ametsuchi {
 
+// value in index_account_history: transaction index and command type in the
+// lowest byte, so duplicates are sorted by transaction index
+static size_t history_value(size_t index, iroha::Command command) {
+  return (index << 8) | static_cast<uint8_t>(command);
+}
+
 
 merkle::hash_t TxStore::append(const std::vector<uint8_t> *blob) {
   auto tx = flatbuffers::GetRoot<iroha::Transaction>(blob->data());
@@ -33,8 +44,7 @@ merkle::hash_t TxStore::append(const std::vector<uint8_t> *blob) {
   {
     c_key.mv_data = &(++tx_store_total);
     c_key.mv_size = sizeof(tx_store_total);
-    c_val.mv_data = (void *)blob->data();
-    c_val.mv_size = blob->size();
+    c_val = compress(blob);
 
     if ((res = mdb_cursor_put(trees_.at("tx_store").second, &c_key, &c_val,
                               MDB_NOOVERWRITE | MDB_APPEND)) != 0) {
@@ -45,7 +55,20 @@ merkle::hash_t TxStore::append(const std::vector<uint8_t> *blob) {
       AMETSUCHI_CRITICAL(res, EINVAL);
     }
   }
-  // 2. insert record into index depending on the command
+  // 2. attachment stored out of line must be in blob store already
+  if (tx->attachment() && tx->attachment()->digest() &&
+      !tx->attachment()->data()) {
+    auto digest = tx->attachment()->digest();
+    if (digest->size() != merkle::HASH_LEN) {
+      throw exception::InvalidTransaction::ATTACHMENT_NOT_FOUND;
+    }
+    merkle::hash_t h;
+    std::copy(digest->begin(), digest->end(), h.begin());
+    if (getBlob(h, true).data == nullptr) {
+      throw exception::InvalidTransaction::ATTACHMENT_NOT_FOUND;
+    }
+  }
+  // 3. insert record into index depending on the command
   {
     auto creator = tx->creatorPubKey();
     if (command_tree_name_.count(tx->command_type()) == 0) {
@@ -56,40 +79,121 @@ merkle::hash_t TxStore::append(const std::vector<uint8_t> *blob) {
           tx_store_total);
     }
   }
-  // 3. insert record into index_transfer_sender and index_transfer_receiver
+  // 4. insert record into index_transfer_sender and index_transfer_receiver
   if (tx->command_type() == iroha::Command::Transfer) {
-    // update index_transfer_sender
     auto cmd = tx->command_as_Transfer();
-    c_key.mv_data = (void *)(cmd->sender()->data());
-    c_key.mv_size = cmd->sender()->size();
+    put_tx_into_tree_by_key(trees_.at("index_transfer_sender").second,
+                            cmd->sender(), tx_store_total);
+    put_tx_into_tree_by_key(trees_.at("index_transfer_receiver").second,
+                            cmd->receiver(), tx_store_total);
+  }
 
-    if ((res = mdb_cursor_put(trees_.at("index_transfer_sender").second, &c_key,
-                              &c_val, 0)) != 0) {
+  // 5. insert record into index_account_history
+  put_tx_into_history(tx);
+
+  // 6. insert record into index_timestamp
+  put_tx_into_time_index(tx);
+
+  // 7. Push to merkle tree
+  merkle::hash_t h;
+  //assert(tx->hash()->size() == merkle::HASH_LEN);
+  std::copy(tx->hash()->begin(), tx->hash()->end(), &h[0]);
+  merkleTree_.push(h);
+
+  // 8. remember root at this height: a syncing peer compares its root with
+  // it to tell a prefix of this ledger from a diverged one, and to verify
+  // fetched chunks
+  {
+    auto root = merkleTree_.root();
+    c_key.mv_data = &tx_store_total;
+    c_key.mv_size = sizeof(tx_store_total);
+    c_val.mv_data = root.data();
+    c_val.mv_size = root.size();
+    if ((res = mdb_cursor_put(trees_.at("merkle_roots").second, &c_key,
+                              &c_val, MDB_APPEND)) != 0) {
+      AMETSUCHI_CRITICAL(res, MDB_KEYEXIST);
       AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
       AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
       AMETSUCHI_CRITICAL(res, EACCES);
       AMETSUCHI_CRITICAL(res, EINVAL);
     }
+    return root;
+  }
+}
 
-    // update index_transfer_receiver
-    c_key.mv_data = (void *)(cmd->receiver()->data());
-    c_key.mv_size = cmd->receiver()->size();
+size_t TxStore::height() const { return tx_store_total; }
 
-    if ((res = mdb_cursor_put(trees_.at("index_transfer_receiver").second,
-                              &c_key, &c_val, 0)) != 0) {
-      AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
-      AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+size_t TxStore::committed_height() const { return committed_total_; }
+
+uint64_t TxStore::committed_order() const { return committed_order_; }
+
+void TxStore::open_segments(const std::string &folder) {
+  segments_.reset(new SegmentStore(folder));
+}
+
+size_t TxStore::archive(size_t upto, MDB_env *env) {
+  MDB_val c_key, c_val;
+  MDB_cursor *cursor;
+  MDB_txn *tx;
+  int res;
+
+  if (!segments_) {
+    console->critical("segments are not opened");
+    throw exception::InternalError::FATAL;
+  }
+
+  size_t first = segments_->last() + 1;
+  if (upto < first) return segments_->last();
+
+  // committed records only, they are read without copy from RO transaction
+  if ((res = mdb_txn_begin(env, nullptr, MDB_RDONLY, &tx)) != 0) {
+    AMETSUCHI_CRITICAL(res, MDB_PANIC);
+    AMETSUCHI_CRITICAL(res, MDB_MAP_RESIZED);
+    AMETSUCHI_CRITICAL(res, MDB_READERS_FULL);
+    AMETSUCHI_CRITICAL(res, ENOMEM);
+  }
+  if ((res = mdb_cursor_open(tx, trees_.at("tx_store").first, &cursor)) != 0) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  std::vector<AM_val> records;
+  size_t index = first;
+  c_key.mv_data = &index;
+  c_key.mv_size = sizeof(index);
+  res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET_RANGE);
+  // store installed from snapshot has no transactions before its height
+  if (res == 0 && segments_->last() == 0) {
+    first = *static_cast<size_t *>(c_key.mv_data);
+  }
+  while (res == 0 && *static_cast<size_t *>(c_key.mv_data) <= upto) {
+    records.push_back(AM_val(c_val));
+    res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_NEXT);
+  }
+  if (res != 0 && res != MDB_NOTFOUND) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  segments_->write(first, records);
+  mdb_cursor_close(cursor);
+  mdb_txn_abort(tx);
+
+  // records are safe in the segment, remove them from LMDB
+  auto last = first + records.size() - 1;
+  cursor = trees_.at("tx_store").second;
+  index = first;
+  c_key.mv_data = &index;
+  c_key.mv_size = sizeof(index);
+  res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET_KEY);
+  while (res == 0 && *static_cast<size_t *>(c_key.mv_data) <= last) {
+    if ((res = mdb_cursor_del(cursor, 0)) != 0) {
       AMETSUCHI_CRITICAL(res, EACCES);
       AMETSUCHI_CRITICAL(res, EINVAL);
     }
+    // cursor is moved to the next record, if there is one
+    res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_GET_CURRENT);
   }
 
-  // 4. Push to merkle tree
-  merkle::hash_t h;
-  //assert(tx->hash()->size() == merkle::HASH_LEN);
-  std::copy(tx->hash()->begin(), tx->hash()->end(), &h[0]);
-  merkleTree_.push(h);
-  return merkleTree_.root();
+  return segments_->last();
 }
 
 void TxStore::init(MDB_txn *append_tx) {
@@ -98,6 +202,8 @@ void TxStore::init(MDB_txn *append_tx) {
   // autoincrement_key => tx (NODUP)
   create_new_tree(append_tx_, "tx_store", MDB_CREATE | MDB_INTEGERKEY);
   create_new_tree(append_tx_, "merkle_tree", MDB_CREATE | MDB_INTEGERKEY);
+  // height => merkle root after the transaction (NODUP)
+  create_new_tree(append_tx_, "merkle_roots", MDB_CREATE | MDB_INTEGERKEY);
 
   // TxStore trees: [pubkey] => [autoincrement_key] (DUP)
   // This tree is one-to-one correspondence with commands.
@@ -114,7 +220,30 @@ void TxStore::init(MDB_txn *append_tx) {
   create_new_tree(append_tx, "index_transfer_receiver",
                   MDB_DUPSORT | MDB_DUPFIXED | MDB_CREATE);
 
+  // [pubkey] => [autoincrement_key << 8 | command] (DUP)
+  // Every transaction, which touches the account.
+  create_new_tree(append_tx, "index_account_history",
+                  MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP | MDB_CREATE);
+
+  // [timestamp] => [autoincrement_key] (DUP)
+  create_new_tree(append_tx, "index_timestamp",
+                  MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP |
+                      MDB_CREATE);
+
+  // [name] => value (NODUP), e.g. compression dictionary
+  create_new_tree(append_tx, "tx_store_meta", MDB_CREATE);
+
+  // [sha3_256(blob)] => blob (NODUP), e.g. large attachments
+  create_new_tree(append_tx, "blob_store", MDB_CREATE);
+
+  if (compression_level_ > 0 && cdict_ == nullptr) {
+    load_dictionary();
+  }
+
   set_tx_total();
+  // new append transaction starts from committed state
+  committed_total_ = tx_store_total;
+  load_order();
   assert(get_trees_total() == trees_.size());
 }
 
@@ -127,7 +256,15 @@ void TxStore::close_cursors() {
   }
 }
 
-TxStore::TxStore(size_t merkle_leaves) : merkleTree_(merkle_leaves) {
+TxStore::TxStore(size_t merkle_leaves, int compression_level)
+    : merkle_leaves_(merkle_leaves),
+      merkleTree_(merkle_leaves),
+      compression_level_(compression_level) {
+  if (compression_level_ > 0) {
+    cctx_ = ZSTD_createCCtx();
+  }
+  dctx_ = ZSTD_createDCtx();
+
   // Initiate [command] = command_tree_name;
   // Use for operate Asset.
   command_tree_name_[iroha::Command::Add] = "index_asset_add";
@@ -169,7 +306,196 @@ TxStore::TxStore(size_t merkle_leaves) : merkleTree_(merkle_leaves) {
   command_tree_name_[iroha::Command::PermissionAdd] = "index_permission_add";
 }
 
-TxStore::~TxStore() = default;
+TxStore::~TxStore() {
+  free_dictionary();
+  if (cctx_ != nullptr) ZSTD_freeCCtx(cctx_);
+  ZSTD_freeDCtx(dctx_);
+}
+
+bool TxStore::compressed() const { return cdict_ != nullptr; }
+
+MDB_val TxStore::compress(const std::vector<uint8_t> *blob) {
+  MDB_val val;
+  val.mv_data = (void *)blob->data();
+  val.mv_size = blob->size();
+
+  if (compression_level_ <= 0) {
+    return val;
+  }
+
+  if (cdict_ == nullptr) {
+    // not trained yet, keep transaction as a sample
+    if (sample_sizes_.size() < AMETSUCHI_TX_DICT_SAMPLES) {
+      samples_.insert(samples_.end(), blob->begin(), blob->end());
+      sample_sizes_.push_back(blob->size());
+    }
+    return val;
+  }
+
+  compressed_.resize(ZSTD_compressBound(blob->size()));
+  auto size =
+      ZSTD_compress_usingCDict(cctx_, compressed_.data(), compressed_.size(),
+                               blob->data(), blob->size(), cdict_);
+  // store as is, if compression does not pay off
+  if (ZSTD_isError(size) || size >= blob->size()) {
+    return val;
+  }
+
+  val.mv_data = compressed_.data();
+  val.mv_size = size;
+  return val;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> TxStore::decompress(
+    const MDB_val &val, size_t index, bool uncommitted) {
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+
+  if (!uncommitted) {
+    auto it = cache_.find(index);
+    if (it != cache_.end()) {
+      cache_order_.splice(cache_order_.begin(), cache_order_,
+                          it->second.second);
+      return it->second.first;
+    }
+  }
+
+  if (ddict_ == nullptr) {
+    console->critical("transaction {} is compressed, but there is no dictionary",
+                      index);
+    throw exception::InternalError::FATAL;
+  }
+
+  auto size = ZSTD_getFrameContentSize(val.mv_data, val.mv_size);
+  if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR) {
+    console->critical("transaction {} is corrupted", index);
+    throw exception::InternalError::FATAL;
+  }
+
+  auto blob = std::make_shared<std::vector<uint8_t>>(size);
+  auto res = ZSTD_decompress_usingDDict(dctx_, blob->data(), blob->size(),
+                                        val.mv_data, val.mv_size, ddict_);
+  if (ZSTD_isError(res)) {
+    console->critical("transaction {} is corrupted: {}", index,
+                      ZSTD_getErrorName(res));
+    throw exception::InternalError::FATAL;
+  }
+
+  // uncommitted transaction may be rolled back, it is not cached
+  if (uncommitted) {
+    return blob;
+  }
+
+  if (cache_.size() >= AMETSUCHI_TX_CACHE_SIZE) {
+    cache_.erase(cache_order_.back());
+    cache_order_.pop_back();
+  }
+  cache_order_.push_front(index);
+  auto &entry = cache_[index];
+  entry.first = blob;
+  entry.second = cache_order_.begin();
+  return blob;
+}
+
+void TxStore::load_dictionary() {
+  MDB_val c_key, c_val;
+  int res;
+
+  std::string name = "zstd_dict";
+  c_key.mv_data = (void *)name.data();
+  c_key.mv_size = name.size();
+  if ((res = mdb_cursor_get(trees_.at("tx_store_meta").second, &c_key, &c_val,
+                            MDB_SET)) != 0) {
+    if (res == MDB_NOTFOUND) return;
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  auto data = static_cast<const uint8_t *>(c_val.mv_data);
+  dict_.assign(data, data + c_val.mv_size);
+  cdict_ = ZSTD_createCDict(dict_.data(), dict_.size(), compression_level_);
+  ddict_ = ZSTD_createDDict(dict_.data(), dict_.size());
+
+  samples_.clear();
+  sample_sizes_.clear();
+}
+
+void TxStore::train_dictionary() {
+  MDB_val c_key, c_val;
+  int res;
+
+  std::vector<uint8_t> dict(AMETSUCHI_TX_DICT_SIZE);
+  auto size = ZDICT_trainFromBuffer(dict.data(), dict.size(), samples_.data(),
+                                    sample_sizes_.data(),
+                                    static_cast<unsigned>(sample_sizes_.size()));
+  samples_.clear();
+  sample_sizes_.clear();
+  if (ZDICT_isError(size)) {
+    // too few or too random samples, collect new ones
+    console->warn("compression dictionary is not trained: {}",
+                  ZDICT_getErrorName(size));
+    return;
+  }
+  dict.resize(size);
+
+  std::string name = "zstd_dict";
+  c_key.mv_data = (void *)name.data();
+  c_key.mv_size = name.size();
+  c_val.mv_data = dict.data();
+  c_val.mv_size = dict.size();
+  if ((res = mdb_cursor_put(trees_.at("tx_store_meta").second, &c_key, &c_val,
+                            0))) {
+    AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
+    AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+    AMETSUCHI_CRITICAL(res, EACCES);
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  dict_ = std::move(dict);
+  cdict_ = ZSTD_createCDict(dict_.data(), dict_.size(), compression_level_);
+  ddict_ = ZSTD_createDDict(dict_.data(), dict_.size());
+}
+
+void TxStore::free_dictionary() {
+  if (cdict_ != nullptr) ZSTD_freeCDict(cdict_);
+  if (ddict_ != nullptr) ZSTD_freeDDict(ddict_);
+  cdict_ = nullptr;
+  ddict_ = nullptr;
+}
+
+void TxStore::set_order(uint64_t order) {
+  MDB_val c_key, c_val;
+  int res;
+
+  std::string name = "consensus_order";
+  c_key.mv_data = (void *)name.data();
+  c_key.mv_size = name.size();
+  c_val.mv_data = &order;
+  c_val.mv_size = sizeof(order);
+  if ((res = mdb_cursor_put(trees_.at("tx_store_meta").second, &c_key, &c_val,
+                            0))) {
+    AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
+    AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+    AMETSUCHI_CRITICAL(res, EACCES);
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+}
+
+void TxStore::load_order() {
+  MDB_val c_key, c_val;
+  int res;
+
+  std::string name = "consensus_order";
+  c_key.mv_data = (void *)name.data();
+  c_key.mv_size = name.size();
+  if ((res = mdb_cursor_get(trees_.at("tx_store_meta").second, &c_key, &c_val,
+                            MDB_SET)) != 0) {
+    if (res != MDB_NOTFOUND) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+    committed_order_ = 0;
+  } else {
+    committed_order_ = *static_cast<uint64_t *>(c_val.mv_data);
+  }
+}
 
 void TxStore::set_tx_total() {
   MDB_val c_key, c_val;
@@ -185,6 +511,122 @@ void TxStore::set_tx_total() {
   } else {
     tx_store_total = *reinterpret_cast<size_t *>(c_key.mv_data);
   }
+
+  // every transaction may be archived
+  if (segments_ && segments_->last() > tx_store_total) {
+    tx_store_total = segments_->last();
+  }
+
+  // store installed from snapshot starts after its height
+  std::string name = "base_height";
+  c_key.mv_data = (void *)name.data();
+  c_key.mv_size = name.size();
+  if ((res = mdb_cursor_get(trees_.at("tx_store_meta").second, &c_key, &c_val,
+                            MDB_SET)) != 0) {
+    if (res != MDB_NOTFOUND) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+  } else if (*static_cast<size_t *>(c_val.mv_data) > tx_store_total) {
+    tx_store_total = *static_cast<size_t *>(c_val.mv_data);
+  }
+}
+
+
+SnapshotInfo TxStore::snapshot(MDB_txn *from, MDB_txn *to) {
+  MDB_val c_key, c_val;
+  MDB_cursor *cursor;
+  int res;
+
+  SnapshotInfo info;
+  info.height = 0;
+  merkle::MerkleTree tree(merkle_leaves_);
+
+  for (auto name : {"merkle_tree", "tx_store_meta"}) {
+    unsigned int flags;
+    auto dbi = trees_.at(name).first;
+    if ((res = mdb_dbi_flags(from, dbi, &flags)) != 0) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+    auto target = init_btree(to, name, flags | MDB_CREATE);
+    if ((res = mdb_cursor_open(from, dbi, &cursor)) != 0) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+
+    res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_FIRST);
+    while (res == 0) {
+      if ((res = mdb_cursor_put(target.second, &c_key, &c_val, MDB_APPEND)) !=
+          0) {
+        AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
+        AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+        AMETSUCHI_CRITICAL(res, EACCES);
+        AMETSUCHI_CRITICAL(res, EINVAL);
+      }
+      // frontier of the committed merkle tree, as in init_merkle_tree()
+      if (dbi == trees_.at("merkle_tree").first) {
+        merkle::hash_t hash;
+        std::copy(static_cast<const uint8_t *>(c_val.mv_data),
+                  static_cast<const uint8_t *>(c_val.mv_data) + merkle::HASH_LEN,
+                  hash.begin());
+        tree.push(hash);
+      } else if (std::string(static_cast<const char *>(c_key.mv_data),
+                             c_key.mv_size) == "base_height") {
+        info.height = *static_cast<size_t *>(c_val.mv_data);
+      }
+      res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_NEXT);
+    }
+    if (res != MDB_NOTFOUND) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+    mdb_cursor_close(cursor);
+
+    if (dbi == trees_.at("tx_store_meta").first) {
+      // committed height: the last stored or archived transaction
+      if ((res = mdb_cursor_open(from, trees_.at("tx_store").first,
+                                 &cursor)) != 0) {
+        AMETSUCHI_CRITICAL(res, EINVAL);
+      }
+      if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_LAST)) == 0) {
+        info.height =
+            std::max(info.height, *static_cast<size_t *>(c_key.mv_data));
+      } else if (res != MDB_NOTFOUND) {
+        AMETSUCHI_CRITICAL(res, EINVAL);
+      }
+      mdb_cursor_close(cursor);
+      if (segments_) {
+        info.height = std::max(info.height, segments_->last());
+      }
+
+      std::string name = "base_height";
+      c_key.mv_data = (void *)name.data();
+      c_key.mv_size = name.size();
+      c_val.mv_data = &info.height;
+      c_val.mv_size = sizeof(info.height);
+      if ((res = mdb_cursor_put(target.second, &c_key, &c_val, 0)) != 0) {
+        AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
+        AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+        AMETSUCHI_CRITICAL(res, EACCES);
+        AMETSUCHI_CRITICAL(res, EINVAL);
+      }
+    }
+    mdb_cursor_close(target.second);
+  }
+
+  info.root = tree.root();
+
+  // root at the snapshot height, peers syncing from it are compared with it
+  auto roots = init_btree(to, "merkle_roots", MDB_CREATE | MDB_INTEGERKEY);
+  c_key.mv_data = &info.height;
+  c_key.mv_size = sizeof(info.height);
+  c_val.mv_data = info.root.data();
+  c_val.mv_size = info.root.size();
+  if ((res = mdb_cursor_put(roots.second, &c_key, &c_val, 0)) != 0) {
+    AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
+    AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+    AMETSUCHI_CRITICAL(res, EACCES);
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+  mdb_cursor_close(roots.second);
+  return info;
 }
 void TxStore::close_dbi(MDB_env *env) {
   for (auto &&it : trees_) {
@@ -193,7 +635,7 @@ void TxStore::close_dbi(MDB_env *env) {
   }
 }
 uint32_t TxStore::get_trees_total() {
-  TX_STORE_TREES_TOTAL = 25;
+  TX_STORE_TREES_TOTAL = 30;
   return TX_STORE_TREES_TOTAL;
 }
 
@@ -216,6 +658,135 @@ void TxStore::put_tx_into_tree_by_key(MDB_cursor *cursor,
   }
 }
 
+void TxStore::put_tx_into_history(const iroha::Transaction *tx) {
+  // accounts touched by the transaction
+  std::vector<const flatbuffers::String *> keys{tx->creatorPubKey()};
+  switch (tx->command_type()) {
+    case iroha::Command::Add:
+      keys.push_back(tx->command_as_Add()->accPubKey());
+      break;
+    case iroha::Command::Subtract:
+      keys.push_back(tx->command_as_Subtract()->accPubKey());
+      break;
+    case iroha::Command::Transfer:
+      keys.push_back(tx->command_as_Transfer()->sender());
+      keys.push_back(tx->command_as_Transfer()->receiver());
+      break;
+    case iroha::Command::AccountAdd:
+      keys.push_back(
+          tx->command_as_AccountAdd()->account_nested_root()->pubKey());
+      break;
+    case iroha::Command::AccountRemove:
+      keys.push_back(tx->command_as_AccountRemove()->pubkey());
+      break;
+    case iroha::Command::PermissionAdd:
+      keys.push_back(tx->command_as_PermissionAdd()->targetAccount());
+      break;
+    case iroha::Command::PermissionRemove:
+      keys.push_back(tx->command_as_PermissionRemove()->targetAccount());
+      break;
+    default:
+      break;
+  }
+
+  MDB_val c_key, c_val;
+  int res;
+  size_t value = history_value(tx_store_total, tx->command_type());
+  c_val.mv_data = &value;
+  c_val.mv_size = sizeof(value);
+
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (keys[i] == nullptr) continue;
+
+    // every account is put only once
+    auto same = [&](const flatbuffers::String *key) {
+      return key != nullptr && key->str() == keys[i]->str();
+    };
+    if (std::any_of(keys.begin(), keys.begin() + i, same)) continue;
+
+    c_key.mv_data = (void *)(keys[i]->data());
+    c_key.mv_size = keys[i]->size();
+    if ((res = mdb_cursor_put(trees_.at("index_account_history").second,
+                              &c_key, &c_val, 0)) != 0) {
+      AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
+      AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+      AMETSUCHI_CRITICAL(res, EACCES);
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+  }
+}
+
+void TxStore::put_tx_into_time_index(const iroha::Transaction *tx) {
+  MDB_val c_key, c_val;
+  int res;
+
+  // INTEGERKEY requires size_t keys
+  size_t timestamp = tx->timestamp();
+  c_key.mv_data = &timestamp;
+  c_key.mv_size = sizeof(timestamp);
+  c_val.mv_data = &tx_store_total;
+  c_val.mv_size = sizeof(tx_store_total);
+
+  if ((res = mdb_cursor_put(trees_.at("index_timestamp").second, &c_key,
+                            &c_val, 0)) != 0) {
+    AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
+    AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+    AMETSUCHI_CRITICAL(res, EACCES);
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+}
+
+
+void TxStore::walk_time_index(MDB_cursor *cursor, uint64_t from, uint64_t to,
+                              const std::function<void(size_t)> &f) {
+  MDB_val c_key, c_val;
+  int res;
+
+  size_t timestamp = from;
+  c_key.mv_data = &timestamp;
+  c_key.mv_size = sizeof(timestamp);
+
+  // first record with timestamp >= from, then every next one (with dups)
+  res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET_RANGE);
+  while (res == 0 && *static_cast<size_t *>(c_key.mv_data) <= to) {
+    f(*static_cast<size_t *>(c_val.mv_data));
+    res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_NEXT);
+  }
+  if (res != 0 && res != MDB_NOTFOUND) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+}
+
+
+AM_val TxStore::read_tx(MDB_cursor *tx_cursor, size_t index,
+                        bool uncommitted) {
+  MDB_val tx_key, tx_val;
+  int res;
+
+  tx_key.mv_data = &index;
+  tx_key.mv_size = sizeof(index);
+  if ((res = mdb_cursor_get(tx_cursor, &tx_key, &tx_val, MDB_SET_KEY)) != 0) {
+    // old transactions may be archived
+    if (res != MDB_NOTFOUND || !segments_ || !segments_->get(index, tx_val)) {
+      AMETSUCHI_CRITICAL(res, MDB_NOTFOUND);
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+  }
+
+  // compressed records start with zstd magic number, flatbuffer can not
+  // start with it (it would be offset of the root table)
+  uint32_t magic = 0;
+  if (tx_val.mv_size >= sizeof(magic)) {
+    std::memcpy(&magic, tx_val.mv_data, sizeof(magic));
+  }
+  if (magic != ZSTD_MAGICNUMBER) {
+    // plain record, mmaped from disk
+    return AM_val(tx_val);
+  }
+
+  return AM_val(decompress(tx_val, index, uncommitted));
+}
+
 
 std::vector<AM_val> TxStore::getTxByKey(const std::string &tree_name,
                                         const flatbuffers::String *pubKey,
@@ -258,7 +829,6 @@ std::vector<AM_val> TxStore::getTxByKey(const std::string &tree_name,
   // index tree has transactions. try to find asset with the same `pk`
   // iterate over creator's transactions, O(N), where N is number of different
   // transactions,
-  MDB_val tx_key, tx_val;
   MDB_cursor *tx_cursor;
 
   if (uncommitted) {
@@ -271,12 +841,8 @@ std::vector<AM_val> TxStore::getTxByKey(const std::string &tree_name,
   }
 
   do {
-    tx_key = c_val;
-    if ((res = mdb_cursor_get(tx_cursor, &tx_key, &tx_val, MDB_FIRST)) != 0) {
-      AMETSUCHI_CRITICAL(res, MDB_NOTFOUND);
-      AMETSUCHI_CRITICAL(res, EINVAL);
-    }
-    ret.push_back(AM_val(tx_val));
+    ret.push_back(read_tx(tx_cursor, *static_cast<size_t *>(c_val.mv_data),
+                          uncommitted));
     if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_NEXT_DUP)) != 0) {
       if (res == MDB_NOTFOUND) {
         break;
@@ -299,8 +865,104 @@ void TxStore::create_new_tree(MDB_txn *append_tx, const std::string &name,
   trees_[name] = init_btree(append_tx, name, flags, dupsort);
 }
 
+merkle::hash_t TxStore::putBlob(const uint8_t *data, size_t size) {
+  MDB_val c_key, c_val;
+  int res;
+
+  auto digest = merkle::MerkleTree::hash(data, size);
+  c_key.mv_data = digest.data();
+  c_key.mv_size = digest.size();
+  c_val.mv_data = (void *)data;
+  c_val.mv_size = size;
+
+  // same content has the same key, so it is stored only once
+  if ((res = mdb_cursor_put(trees_.at("blob_store").second, &c_key, &c_val,
+                            MDB_NOOVERWRITE)) != 0 &&
+      res != MDB_KEYEXIST) {
+    AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
+    AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+    AMETSUCHI_CRITICAL(res, EACCES);
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+  return digest;
+}
+
+bool TxStore::merkle_root(size_t height, merkle::hash_t &root,
+                          MDB_env *env) {
+  MDB_val c_key, c_val;
+  MDB_cursor *cursor;
+  MDB_txn *tx;
+  int res;
+
+  // create read-only transaction, create new RO cursor
+  if ((res = mdb_txn_begin(env, nullptr, MDB_RDONLY, &tx)) != 0) {
+    AMETSUCHI_CRITICAL(res, MDB_PANIC);
+    AMETSUCHI_CRITICAL(res, MDB_MAP_RESIZED);
+    AMETSUCHI_CRITICAL(res, MDB_READERS_FULL);
+    AMETSUCHI_CRITICAL(res, ENOMEM);
+  }
+  if ((res = mdb_cursor_open(tx, trees_.at("merkle_roots").first,
+                             &cursor)) != 0) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  c_key.mv_data = &height;
+  c_key.mv_size = sizeof(height);
+  res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET_KEY);
+  if (res == 0) {
+    std::copy(static_cast<const uint8_t *>(c_val.mv_data),
+              static_cast<const uint8_t *>(c_val.mv_data) + merkle::HASH_LEN,
+              root.begin());
+  } else if (res != MDB_NOTFOUND) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  mdb_cursor_close(cursor);
+  mdb_txn_abort(tx);
+  return res == 0;
+}
+
+AM_val TxStore::getBlob(const merkle::hash_t &digest, bool uncommitted,
+                        MDB_env *env) {
+  MDB_val c_key, c_val;
+  MDB_cursor *cursor;
+  MDB_txn *tx;
+  int res;
+
+  if (uncommitted) {
+    cursor = trees_.at("blob_store").second;
+  } else {
+    // create read-only transaction, create new RO cursor
+    if ((res = mdb_txn_begin(env, nullptr, MDB_RDONLY, &tx)) != 0) {
+      AMETSUCHI_CRITICAL(res, MDB_PANIC);
+      AMETSUCHI_CRITICAL(res, MDB_MAP_RESIZED);
+      AMETSUCHI_CRITICAL(res, MDB_READERS_FULL);
+      AMETSUCHI_CRITICAL(res, ENOMEM);
+    }
+    if ((res = mdb_cursor_open(tx, trees_.at("blob_store").first, &cursor)) !=
+        0) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+  }
+
+  c_key.mv_data = (void *)digest.data();
+  c_key.mv_size = digest.size();
+  if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET_KEY)) != 0) {
+    if (res != MDB_NOTFOUND) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+    c_val.mv_data = nullptr;
+    c_val.mv_size = 0;
+  }
+
+  if (!uncommitted) {
+    mdb_cursor_close(cursor);
+    mdb_txn_abort(tx);
+  }
+  return AM_val(c_val);
+}
+
 AM_val TxStore::getTransaction(size_t index, bool uncommitted, MDB_env *env) {
-  MDB_val tx_key, tx_val;
   MDB_cursor *tx_cursor;
   MDB_txn *tx;
   int res;
@@ -321,17 +983,12 @@ AM_val TxStore::getTransaction(size_t index, bool uncommitted, MDB_env *env) {
     }
   }
 
-  tx_key.mv_data = &index;
-  tx_key.mv_size = sizeof(index);
-  if ((res = mdb_cursor_get(tx_cursor, &tx_key, &tx_val, MDB_FIRST)) != 0) {
-    AMETSUCHI_CRITICAL(res, MDB_NOTFOUND);
-    AMETSUCHI_CRITICAL(res, EINVAL);
-  }
+  auto ret = read_tx(tx_cursor, index, uncommitted);
   if (!uncommitted) {
     mdb_cursor_close(tx_cursor);
     mdb_txn_abort(tx);
   }
-  return AM_val(tx_val);
+  return ret;
 }
 
 std::vector<AM_val> TxStore::getAssetTransferBySender(
@@ -351,6 +1008,157 @@ std::vector<AM_val> TxStore::getCommandByKey(const flatbuffers::String *pubKey,
   return getTxByKey(command_tree_name_[command], pubKey, uncommitted, env);
 }
 
+std::vector<HistoryRecord> TxStore::getAccountHistory(
+    const flatbuffers::String *pubKey, bool uncommitted, MDB_env *env) {
+  return account_history(pubKey, nullptr, uncommitted, env);
+}
+
+
+std::vector<HistoryRecord> TxStore::getAccountHistory(
+    const flatbuffers::String *pubKey, uint64_t from, uint64_t to,
+    bool uncommitted, MDB_env *env) {
+  auto indexes = getTxIndexesByTime(from, to, uncommitted, env);
+  return account_history(pubKey, &indexes, uncommitted, env);
+}
+
+
+std::vector<size_t> TxStore::getTxIndexesByTime(uint64_t from, uint64_t to,
+                                                bool uncommitted,
+                                                MDB_env *env) {
+  MDB_cursor *cursor;
+  MDB_txn *tx;
+  int res;
+
+  if (uncommitted) {
+    cursor = trees_.at("index_timestamp").second;
+  } else {
+    // create read-only transaction, create new RO cursor
+    if ((res = mdb_txn_begin(env, nullptr, MDB_RDONLY, &tx)) != 0) {
+      AMETSUCHI_CRITICAL(res, MDB_PANIC);
+      AMETSUCHI_CRITICAL(res, MDB_MAP_RESIZED);
+      AMETSUCHI_CRITICAL(res, MDB_READERS_FULL);
+      AMETSUCHI_CRITICAL(res, ENOMEM);
+    }
+    if ((res = mdb_cursor_open(tx, trees_.at("index_timestamp").first,
+                               &cursor)) != 0) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+  }
+
+  std::vector<size_t> ret;
+  walk_time_index(cursor, from, to,
+                  [&ret](size_t index) { ret.push_back(index); });
+  std::sort(ret.begin(), ret.end());
+
+  if (!uncommitted) {
+    mdb_cursor_close(cursor);
+    mdb_txn_abort(tx);
+  }
+  return ret;
+}
+
+
+std::vector<AM_val> TxStore::getTransactionsByTime(uint64_t from, uint64_t to,
+                                                   bool uncommitted,
+                                                   MDB_env *env) {
+  MDB_cursor *cursor, *tx_cursor;
+  MDB_txn *tx;
+  int res;
+
+  if (uncommitted) {
+    cursor = trees_.at("index_timestamp").second;
+    tx_cursor = trees_.at("tx_store").second;
+  } else {
+    // create read-only transaction, create new RO cursors
+    if ((res = mdb_txn_begin(env, nullptr, MDB_RDONLY, &tx)) != 0) {
+      AMETSUCHI_CRITICAL(res, MDB_PANIC);
+      AMETSUCHI_CRITICAL(res, MDB_MAP_RESIZED);
+      AMETSUCHI_CRITICAL(res, MDB_READERS_FULL);
+      AMETSUCHI_CRITICAL(res, ENOMEM);
+    }
+    if ((res = mdb_cursor_open(tx, trees_.at("index_timestamp").first,
+                               &cursor)) != 0) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+    if ((res = mdb_cursor_open(tx, trees_.at("tx_store").first, &tx_cursor)) !=
+        0) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+  }
+
+  std::vector<AM_val> ret;
+  walk_time_index(cursor, from, to, [&](size_t index) {
+    ret.push_back(read_tx(tx_cursor, index, uncommitted));
+  });
+
+  if (!uncommitted) {
+    mdb_cursor_close(cursor);
+    mdb_cursor_close(tx_cursor);
+    mdb_txn_abort(tx);
+  }
+  return ret;
+}
+
+
+std::vector<HistoryRecord> TxStore::account_history(
+    const flatbuffers::String *pubKey, const std::vector<size_t> *indexes,
+    bool uncommitted, MDB_env *env) {
+  MDB_val c_key, c_val;
+  MDB_cursor *cursor, *tx_cursor;
+  MDB_txn *tx;
+  int res;
+
+  if (uncommitted) {
+    cursor = trees_.at("index_account_history").second;
+    tx_cursor = trees_.at("tx_store").second;
+  } else {
+    // create read-only transaction, create new RO cursors
+    if ((res = mdb_txn_begin(env, nullptr, MDB_RDONLY, &tx)) != 0) {
+      AMETSUCHI_CRITICAL(res, MDB_PANIC);
+      AMETSUCHI_CRITICAL(res, MDB_MAP_RESIZED);
+      AMETSUCHI_CRITICAL(res, MDB_READERS_FULL);
+      AMETSUCHI_CRITICAL(res, ENOMEM);
+    }
+    if ((res = mdb_cursor_open(tx, trees_.at("index_account_history").first,
+                               &cursor)) != 0) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+    if ((res = mdb_cursor_open(tx, trees_.at("tx_store").first, &tx_cursor)) !=
+        0) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+  }
+
+  c_key.mv_data = (void *)pubKey->data();
+  c_key.mv_size = pubKey->size();
+
+  // single walk over account's duplicates, they are sorted by index
+  std::vector<HistoryRecord> ret;
+  res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET);
+  while (res == 0) {
+    auto value = *static_cast<size_t *>(c_val.mv_data);
+    auto index = value >> 8;
+    if (indexes == nullptr ||
+        std::binary_search(indexes->begin(), indexes->end(), index)) {
+      ret.push_back(HistoryRecord{index,
+                                  static_cast<iroha::Command>(value & 0xff),
+                                  read_tx(tx_cursor, index, uncommitted)});
+    }
+
+    res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_NEXT_DUP);
+  }
+  if (res != MDB_NOTFOUND) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  if (!uncommitted) {
+    mdb_cursor_close(cursor);
+    mdb_cursor_close(tx_cursor);
+    mdb_txn_abort(tx);
+  }
+  return ret;
+}
+
 
 merkle::hash_t TxStore::merkle_root() { return merkleTree_.root(); }
 
@@ -358,6 +1166,12 @@ void TxStore::commit() {
   int res;
   MDB_val c_key, c_val;
 
+  // enough transactions are stored as is, next ones will be compressed
+  if (compression_level_ > 0 && cdict_ == nullptr &&
+      sample_sizes_.size() >= AMETSUCHI_TX_DICT_SAMPLES) {
+    train_dictionary();
+  }
+
   // Clear old hashes
   if ((res = mdb_drop(append_tx_, trees_.at("merkle_tree").first, 0))) {
     AMETSUCHI_CRITICAL(res, EINVAL);
@@ -383,6 +1197,7 @@ void TxStore::commit() {
   }
 }
 void TxStore::init_merkle_tree() {
+  merkleTree_ = merkle::MerkleTree(merkle_leaves_);
   auto records = read_all_records(trees_.at("merkle_tree").second);
   for (auto &record : records) {
     merkle::hash_t hash;
@@ -19,6 +19,7 @@
 #include <ametsuchi/currency.h>
 #include <ametsuchi/wsv.h>
 #include <transaction_generated.h>
+#include <cstring>
 #include <iostream>
 
 namespace ametsuchi {
@@ -72,23 +73,39 @@ void WSV::init(MDB_txn *append_tx) {
   trees_["wsv_pubkey_peer"] =
       init_btree(append_tx_, "wsv_pubkey_peer", MDB_CREATE);
 
+  // [ledger_name+domain_name+asset_name] => total supply, holders (NODUP)
+  trees_["wsv_assetid_stats"] =
+      init_btree(append_tx_, "wsv_assetid_stats", MDB_CREATE);
+
+  // [pubkey\0ledger_name+domain_name+asset_name\0height] => asset (NODUP)
+  trees_["wsv_balance_history"] =
+      init_btree(append_tx_, "wsv_balance_history", MDB_CREATE);
+
   // we should know created assets, so read entire table in memory
   read_created_assets();
 
+  // new append transaction, cached balances may be rolled back
+  balances_.clear();
+  stats_.clear();
 }
 
-void WSV::update(const std::vector<uint8_t> *blob) {
+void WSV::update(const std::vector<uint8_t> *blob, size_t height) {
   auto tx = flatbuffers::GetRoot<iroha::Transaction>(blob->data());
+  height_ = height;
   // 4. update WSV
   {
     switch (tx->command_type()) {
       //  Use for operate Asset.
       case iroha::Command::Add: {
-        add(tx->command_as_Add());
+        if (owns(tx->command_as_Add()->accPubKey())) {
+          add(tx->command_as_Add());
+        }
         break;
       }
       case iroha::Command::Subtract: {
-        subtract(tx->command_as_Subtract());
+        if (owns(tx->command_as_Subtract()->accPubKey())) {
+          subtract(tx->command_as_Subtract());
+        }
         break;
       }
       case iroha::Command::Transfer: {
@@ -106,11 +123,15 @@ void WSV::update(const std::vector<uint8_t> *blob) {
       }
       // Use for peer operate
       case iroha::Command::PeerAdd: {
-        peer_add(tx->command_as_PeerAdd());
+        if (partition_index_ == 0) {
+          peer_add(tx->command_as_PeerAdd());
+        }
         break;
       }
       case iroha::Command::PeerRemove: {
-        peer_remove(tx->command_as_PeerRemove());
+        if (partition_index_ == 0) {
+          peer_remove(tx->command_as_PeerRemove());
+        }
         break;
       } /*
        case iroha::Command::PeerSetActive: {
@@ -127,11 +148,17 @@ void WSV::update(const std::vector<uint8_t> *blob) {
        }*/
       // Use for account operate
       case iroha::Command::AccountAdd: {
-        account_add(tx->command_as_AccountAdd());
+        auto account = flatbuffers::GetRoot<iroha::Account>(
+            tx->command_as_AccountAdd()->account()->data());
+        if (owns(account->pubKey())) {
+          account_add(tx->command_as_AccountAdd());
+        }
         break;
       }
       case iroha::Command::AccountRemove: {
-        account_remove(tx->command_as_AccountRemove());
+        if (owns(tx->command_as_AccountRemove()->pubkey())) {
+          account_remove(tx->command_as_AccountRemove());
+        }
         break;
       }
       /*
@@ -165,7 +192,9 @@ void WSV::update(const std::vector<uint8_t> *blob) {
         break;
       }*/
       case iroha::Command::PermissionAdd: {
-        permisson_add(tx->command_as_PermissionAdd());
+        if (owns(tx->command_as_PermissionAdd()->targetAccount())) {
+          permisson_add(tx->command_as_PermissionAdd());
+        }
         break;
       }
       case iroha::Command::PermissionRemove: {
@@ -182,6 +211,26 @@ void WSV::update(const std::vector<uint8_t> *blob) {
 WSV::WSV() {}
 WSV::~WSV() {}
 
+void WSV::set_partition(size_t index, size_t total) {
+  partition_index_ = index;
+  partition_total_ = total;
+}
+
+size_t WSV::partition_of(const flatbuffers::String *pubKey, size_t total) {
+  // FNV-1a, std::hash is not guaranteed to be stable between builds
+  uint64_t hash = 14695981039346656037ULL;
+  for (auto c : *pubKey) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash % total;
+}
+
+bool WSV::owns(const flatbuffers::String *pubKey) const {
+  return partition_total_ == 1 ||
+         partition_of(pubKey, partition_total_) == partition_index_;
+}
+
 void WSV::read_created_assets() {
   auto records = read_all_records(trees_["wsv_assetid_asset"].second);
   created_assets_.clear();
@@ -197,6 +246,49 @@ void WSV::read_created_assets() {
 }
 
 
+void WSV::copy(MDB_txn *from, MDB_txn *to) {
+  // trees of the target are opened with the same flags and comparators
+  WSV target;
+  target.init(to);
+
+  for (auto &&tree : trees_) {
+    MDB_val c_key, c_val;
+    MDB_cursor *cursor;
+    unsigned int flags;
+    int res;
+
+    if ((res = mdb_dbi_flags(from, tree.second.first, &flags)) != 0) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+    if ((res = mdb_cursor_open(from, tree.second.first, &cursor)) != 0) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+
+    // records are read in order, so they are appended to the target
+    auto put_flags = (flags & MDB_DUPSORT) ? MDB_APPENDDUP : MDB_APPEND;
+    auto target_cursor = target.trees_.at(tree.first).second;
+    res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_FIRST);
+    while (res == 0) {
+      if ((res = mdb_cursor_put(target_cursor, &c_key, &c_val, put_flags)) !=
+          0) {
+        AMETSUCHI_CRITICAL(res, MDB_KEYEXIST);
+        AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
+        AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+        AMETSUCHI_CRITICAL(res, EACCES);
+        AMETSUCHI_CRITICAL(res, EINVAL);
+      }
+      res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_NEXT);
+    }
+    if (res != MDB_NOTFOUND) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+    mdb_cursor_close(cursor);
+  }
+
+  target.close_cursors();
+}
+
+
 void WSV::close_cursors() {
   for (auto &&e : trees_) {
     MDB_cursor *cursor = e.second.second;
@@ -232,10 +324,14 @@ void WSV::transfer(const iroha::Transfer *command) {
   if (command->asset_nested_root()->asset_type() != iroha::AnyAsset::Currency)
     throw exception::InternalError::NOT_IMPLEMENTED;
 
-  // TODO: it may write exeption when can't transfer becouse of sender has not
-  // asset.
-  this->account_subtract_currency(command->sender(), command->asset());
-  this->account_add_currency(command->receiver(), command->asset());
+  // sender and receiver may belong to different partitions, sender's one
+  // is updated first (see ShardedWSV::update)
+  if (owns(command->sender())) {
+    this->account_subtract_currency(command->sender(), command->asset());
+  }
+  if (owns(command->receiver())) {
+    this->account_add_currency(command->receiver(), command->asset());
+  }
 }
 
 
@@ -284,6 +380,9 @@ void WSV::asset_create(const iroha::AssetCreate *command) {
   }
 
   created_assets_[pk] = std::vector<uint8_t>{ptr, ptr + fbb.GetSize()};
+
+  // nobody holds the new asset yet
+  stats_[pk] = CachedStats{0, 0, true};
 }
 
 void WSV::asset_remove(const iroha::AssetRemove *command) {
@@ -314,141 +413,257 @@ void WSV::asset_remove(const iroha::AssetRemove *command) {
 }
 
 
+WSV::Balance &WSV::get_balance(const flatbuffers::String *acc_pub_key,
+                               const iroha::Currency *currency, bool create) {
+  std::string key = acc_pub_key->str();
+  key += currency->ledger_name()->str();
+  key += currency->domain_name()->str();
+  key += currency->currency_name()->str();
+
+  auto it = balances_.find(key);
+  if (it != balances_.end()) {
+    return it->second;
+  }
+
+  Balance balance;
+  balance.pubkey = acc_pub_key->str();
+  balance.dirty = false;
+
+  auto account_asset =
+      read_account_asset(acc_pub_key, currency->ledger_name(),
+                         currency->domain_name(), currency->currency_name(),
+                         true, nullptr);
+  if (account_asset != nullptr) {
+    auto account_currency = account_asset->asset_as_Currency();
+    balance.currency_name = account_currency->currency_name()->str();
+    balance.domain_name = account_currency->domain_name()->str();
+    balance.ledger_name = account_currency->ledger_name()->str();
+    balance.description = account_currency->description() != nullptr
+                              ? account_currency->description()->str()
+                              : "";
+    balance.amount = parse(account_currency->amount());
+    balance.precision = account_currency->precision();
+    balance.stored = true;
+  } else {
+    if (!create) {
+      throw exception::InvalidTransaction::ASSET_NOT_FOUND;
+    }
+    // Create new Asset
+    balance.currency_name = currency->currency_name()->str();
+    balance.domain_name = currency->domain_name()->str();
+    balance.ledger_name = currency->ledger_name()->str();
+    balance.description =
+        currency->description() != nullptr ? currency->description()->str() : "";
+    balance.amount = 0;
+    balance.precision = currency->precision();
+    balance.stored = false;
+  }
+
+  return balances_.emplace(key, balance).first->second;
+}
+
 void WSV::account_add_currency(const flatbuffers::String *acc_pub_key,
                                const flatbuffers::Vector<uint8_t> *asset_fb) {
-  int res;
-  MDB_val c_key, c_val;
-  c_key.mv_data = (void *)acc_pub_key->data();
-  c_key.mv_size = acc_pub_key->size();
-  c_val.mv_data = (void *)asset_fb->Data();
-  c_val.mv_size = asset_fb->size();
+  const iroha::Currency *currency =
+      flatbuffers::GetRoot<iroha::Asset>(asset_fb->Data())->asset_as_Currency();
 
-  auto cursor = trees_.at("wsv_pubkey_assets").second;
-  std::vector<uint8_t> copy;
+  auto &balance = get_balance(acc_pub_key, currency, true);
+  auto before = balance.amount;
+
+  Currency current(balance.amount, balance.precision);
+  Currency delta(parse(currency->amount()), currency->precision());
+  balance.amount = (current + delta).get_amount();
+  balance.dirty = true;
+  balance.history[height_] = balance.amount;
+
+  update_stats(balance, before);
+}
+
+void WSV::account_subtract_currency(
+    const flatbuffers::String *acc_pub_key,
+    const flatbuffers::Vector<uint8_t> *asset_fb) {
   const iroha::Currency *currency =
       flatbuffers::GetRoot<iroha::Asset>(asset_fb->Data())->asset_as_Currency();
 
-  try {
-    // may throw ASSET_NOT_FOUND
-    auto account_asset = accountGetAsset(acc_pub_key, currency->ledger_name(),
-                                           currency->domain_name(),
-                                           currency->currency_name(), true);
-    auto account_currency = account_asset->asset_as_Currency();
+  // Asset Not Found Error ( can't subtract )
+  auto &balance = get_balance(acc_pub_key, currency, false);
+  auto before = balance.amount;
 
-    //assert(asset_fb->size() == account_asset.size);
+  Currency current(balance.amount, balance.precision);
+  Currency delta(parse(currency->amount()), currency->precision());
+  // balance is not changed, so a failed transfer does not debit the sender
+  if (current < delta) {
+    throw exception::InvalidTransaction::NOT_ENOUGH_ASSETS;
+  }
+  balance.amount = (current - delta).get_amount();
+  balance.dirty = true;
+  balance.history[height_] = balance.amount;
 
-    Currency current(parse(account_currency->amount()), account_currency->precision());
-    Currency delta(parse(currency->amount()), currency->precision());
-    current = current + delta;
+  update_stats(balance, before);
+}
+
+WSV::CachedStats &WSV::get_stats(const std::string &assetid) {
+  auto it = stats_.find(assetid);
+  if (it != stats_.end()) {
+    return it->second;
+  }
+
+  CachedStats stats{0, 0, false};
+
+  MDB_val c_key, c_val;
+  int res;
+  c_key.mv_data = (void *)assetid.data();
+  c_key.mv_size = assetid.size();
+  if ((res = mdb_cursor_get(trees_.at("wsv_assetid_stats").second, &c_key,
+                            &c_val, MDB_SET)) == 0) {
+    std::memcpy(&stats.total_supply, c_val.mv_data, sizeof(__int128_t));
+    std::memcpy(&stats.holders, (char *)c_val.mv_data + sizeof(__int128_t),
+                sizeof(int64_t));
+  } else if (res != MDB_NOTFOUND) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  return stats_.emplace(assetid, stats).first->second;
+}
+
+void WSV::update_stats(const Balance &balance, __int128_t before) {
+  auto &stats = get_stats(balance.ledger_name + balance.domain_name +
+                          balance.currency_name);
+  stats.total_supply += balance.amount - before;
+  if (before == 0 && balance.amount != 0) stats.holders++;
+  if (before != 0 && balance.amount == 0) stats.holders--;
+  stats.dirty = true;
+}
+
+void WSV::flush() {
+  auto cursor = trees_.at("wsv_pubkey_assets").second;
+  int res;
+
+  for (auto &&e : balances_) {
+    auto &balance = e.second;
+    if (!balance.dirty) continue;
 
     flatbuffers::FlatBufferBuilder fbb;
-    auto copy_asset =
-        iroha::CreateAsset(fbb, iroha::AnyAsset::Currency,
-                           iroha::CreateCurrency(fbb, fbb.CreateSharedString(account_currency->currency_name()),
-                                                 fbb.CreateSharedString(account_currency->domain_name()),
-                                                 fbb.CreateSharedString(account_currency->ledger_name()),
-                                                 fbb.CreateSharedString(account_currency->description()),
-                                                 fbb.CreateSharedString(current.to_string(current.get_amount())),
-                                                 account_currency->precision()).Union()
-        );
-    fbb.Finish(copy_asset);
-    copy = {fbb.GetBufferPointer(), fbb.GetBufferPointer() + fbb.GetSize()};
-
-    // cursor is at the correct asset, just replace with a copy of FB and flag
-    // MDB_CURRENT
-    if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_GET_BOTH ))) {
-      AMETSUCHI_CRITICAL(res, EINVAL);
-    }
-    MDB_val p_val;
-    p_val.mv_data = copy.data();
-    p_val.mv_size = copy.size();
-    if ((res = mdb_cursor_put(cursor, &c_key, &p_val, MDB_CURRENT))) {
-      AMETSUCHI_CRITICAL(res, MDB_KEYEXIST);
-      AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
-      AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
-      AMETSUCHI_CRITICAL(res, EACCES);
-      AMETSUCHI_CRITICAL(res, EINVAL);
-    }
-  } catch (exception::InvalidTransaction e) {
-    // Create new Asset
-    if (e == exception::InvalidTransaction::ASSET_NOT_FOUND) {
+    fbb.Finish(create_currency(fbb, balance, balance.amount));
+
+    MDB_val c_key, c_val;
+    c_key.mv_data = (void *)balance.pubkey.data();
+    c_key.mv_size = balance.pubkey.size();
+    c_val.mv_data = (void *)fbb.GetBufferPointer();
+    c_val.mv_size = fbb.GetSize();
+
+    if (balance.stored) {
+      // comparator compares only names, so cursor is moved to the stored
+      // asset, just replace it with flag MDB_CURRENT
+      MDB_val p_val = c_val;
+      if ((res = mdb_cursor_get(cursor, &c_key, &p_val, MDB_GET_BOTH))) {
+        AMETSUCHI_CRITICAL(res, EINVAL);
+      }
+      if ((res = mdb_cursor_put(cursor, &c_key, &c_val, MDB_CURRENT))) {
+        AMETSUCHI_CRITICAL(res, MDB_KEYEXIST);
+        AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
+        AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+        AMETSUCHI_CRITICAL(res, EACCES);
+        AMETSUCHI_CRITICAL(res, EINVAL);
+      }
+    } else {
       // write to tree
-
       if ((res = mdb_cursor_put(cursor, &c_key, &c_val, 0))) {
         AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
         AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
         AMETSUCHI_CRITICAL(res, EACCES);
         AMETSUCHI_CRITICAL(res, EINVAL);
       }
-    } else {
-      throw;
+      balance.stored = true;
     }
+    balance.dirty = false;
+
+    for (auto &&version : balance.history) {
+      put_balance_history(balance, version.first, version.second);
+    }
+    balance.history.clear();
   }
-}
 
-void WSV::account_subtract_currency(
-    const flatbuffers::String *acc_pub_key,
-    const flatbuffers::Vector<uint8_t> *asset_fb) {
-  int res;
-  MDB_val c_key, c_val;
-  c_key.mv_data = (void *)acc_pub_key->data();
-  c_key.mv_size = acc_pub_key->size();
-  c_val.mv_data = (void *)asset_fb->Data();
-  c_val.mv_size = asset_fb->size();
+  cursor = trees_.at("wsv_assetid_stats").second;
+  for (auto &&e : stats_) {
+    auto &stats = e.second;
+    if (!stats.dirty) continue;
 
-  auto cursor = trees_.at("wsv_pubkey_assets").second;
-  std::vector<uint8_t> copy;
-  const iroha::Currency *currency =
-      flatbuffers::GetRoot<iroha::Asset>(asset_fb->Data())->asset_as_Currency();
+    char buf[sizeof(__int128_t) + sizeof(int64_t)];
+    std::memcpy(buf, &stats.total_supply, sizeof(__int128_t));
+    std::memcpy(buf + sizeof(__int128_t), &stats.holders, sizeof(int64_t));
 
-  try {
-    // may throw ASSET_NOT_FOUND
-    auto account_asset = accountGetAsset(acc_pub_key, currency->ledger_name(),
-                                         currency->domain_name(),
-                                         currency->currency_name(), true);
-    auto account_currency = account_asset->asset_as_Currency();
+    MDB_val c_key, c_val;
+    c_key.mv_data = (void *)e.first.data();
+    c_key.mv_size = e.first.size();
+    c_val.mv_data = (void *)buf;
+    c_val.mv_size = sizeof(buf);
 
-    //assert(asset_fb->size() == account_asset.size);
-    Currency current(parse(account_currency->amount()), account_currency->precision());
-    Currency delta(parse(currency->amount()), currency->precision());
-    current = current - delta;
-
-    flatbuffers::FlatBufferBuilder fbb;
-    auto copy_asset =
-        iroha::CreateAsset(fbb, iroha::AnyAsset::Currency,
-             iroha::CreateCurrency(fbb, fbb.CreateSharedString(account_currency->currency_name()),
-                 fbb.CreateSharedString(account_currency->domain_name()),
-                 fbb.CreateSharedString(account_currency->ledger_name()),
-                 fbb.CreateSharedString(account_currency->description()),
-                 fbb.CreateSharedString(current.to_string(current.get_amount())),
-                 account_currency->precision()).Union()
-        );
-    fbb.Finish(copy_asset);
-    copy = {fbb.GetBufferPointer(), fbb.GetBufferPointer() + fbb.GetSize()};
-
-    // cursor is at the correct asset, just replace with a copy of FB and flag
-    // MDB_CURRENT
-    if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_GET_BOTH ))) {
-      AMETSUCHI_CRITICAL(res, EINVAL);
-    }
-    MDB_val p_val;
-    p_val.mv_data = copy.data();
-    p_val.mv_size = copy.size();
-    if ((res = mdb_cursor_put(cursor, &c_key, &p_val, MDB_CURRENT))) {
-      AMETSUCHI_CRITICAL(res, MDB_KEYEXIST);
+    // NODUP tree, put replaces previous value
+    if ((res = mdb_cursor_put(cursor, &c_key, &c_val, 0))) {
       AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
       AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
       AMETSUCHI_CRITICAL(res, EACCES);
       AMETSUCHI_CRITICAL(res, EINVAL);
     }
-  } catch (exception::InvalidTransaction e) {
-    // Create new Asset
-    if (e == exception::InvalidTransaction::ASSET_NOT_FOUND) {
-      // Asset Not Found Error ( can't subtract )
-      throw;
-    } else {
-      throw;
-    }
+    stats.dirty = false;
+  }
+}
+
+flatbuffers::Offset<iroha::Asset> WSV::create_currency(
+    flatbuffers::FlatBufferBuilder &fbb, const Balance &balance,
+    __int128_t amount) {
+  Currency current(amount, balance.precision);
+  return iroha::CreateAsset(
+      fbb, iroha::AnyAsset::Currency,
+      iroha::CreateCurrencyDirect(
+          fbb, balance.currency_name.c_str(), balance.domain_name.c_str(),
+          balance.ledger_name.c_str(), balance.description.c_str(),
+          current.to_string(current.get_amount()).c_str(), balance.precision)
+          .Union());
+}
+
+std::string WSV::balance_history_key(const std::string &pubkey,
+                                     const std::string &assetid,
+                                     size_t height) {
+  std::string key = pubkey;
+  key += '\0';
+  key += assetid;
+  key += '\0';
+  // big endian height keeps versions sorted with default comparator
+  for (int i = sizeof(uint64_t) - 1; i >= 0; i--) {
+    key += static_cast<char>((static_cast<uint64_t>(height) >> (8 * i)) & 0xff);
+  }
+  return key;
+}
+
+void WSV::put_balance_history(const Balance &balance, size_t height,
+                              __int128_t amount, bool removed) {
+  int res;
+
+  auto key = balance_history_key(
+      balance.pubkey,
+      balance.ledger_name + balance.domain_name + balance.currency_name,
+      height);
+
+  flatbuffers::FlatBufferBuilder fbb;
+  MDB_val c_key, c_val;
+  c_key.mv_data = (void *)key.data();
+  c_key.mv_size = key.size();
+  c_val.mv_data = nullptr;
+  c_val.mv_size = 0;
+  if (!removed) {
+    fbb.Finish(create_currency(fbb, balance, amount));
+    c_val.mv_data = (void *)fbb.GetBufferPointer();
+    c_val.mv_size = fbb.GetSize();
+  }
+
+  if ((res = mdb_cursor_put(trees_.at("wsv_balance_history").second, &c_key,
+                            &c_val, 0))) {
+    AMETSUCHI_CRITICAL(res, MDB_MAP_FULL);
+    AMETSUCHI_CRITICAL(res, MDB_TXN_FULL);
+    AMETSUCHI_CRITICAL(res, EACCES);
+    AMETSUCHI_CRITICAL(res, EINVAL);
   }
 }
 
@@ -487,8 +702,44 @@ void WSV::account_remove(const iroha::AccountRemove *command) {
   c_key.mv_data = (void *)(pubkey->data());
   c_key.mv_size = pubkey->size();
 
+  // removed assets leave aggregates, cached balances must be stored first
+  flush();
+  auto cursor = trees_.at("wsv_pubkey_assets").second;
+  res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET);
+  while (res == 0) {
+    auto currency =
+        flatbuffers::GetRoot<::iroha::Asset>(c_val.mv_data)->asset_as_Currency();
+    Balance balance;
+    balance.pubkey = pubkey->str();
+    balance.ledger_name = currency->ledger_name()->str();
+    balance.domain_name = currency->domain_name()->str();
+    balance.currency_name = currency->currency_name()->str();
+    balance.description = currency->description() != nullptr
+                              ? currency->description()->str()
+                              : "";
+    balance.precision = currency->precision();
+    balance.amount = 0;
+    update_stats(balance, parse(currency->amount()));
+    // removed account has nothing since this height
+    put_balance_history(balance, height_, 0, true);
+
+    res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_NEXT_DUP);
+  }
+  if (res != MDB_NOTFOUND) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  // forget cached balances, account's assets are removed below
+  for (auto it = balances_.begin(); it != balances_.end();) {
+    if (it->second.pubkey == pubkey->str()) {
+      it = balances_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
   // move cursor to account in pubkey_account tree
-  auto cursor = trees_.at("wsv_pubkey_account").second;
+  cursor = trees_.at("wsv_pubkey_account").second;
   if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET))) {
     if (res == MDB_NOTFOUND)
       throw exception::InvalidTransaction::ACCOUNT_NOT_FOUND;
@@ -714,10 +965,20 @@ void WSV::permisson_add(const iroha::PermissionAdd *command) {
 void WSV::permisson_remove(const iroha::PermissionRemove *command) {}
 
 ::iroha::Asset *WSV::accountGetAsset(const flatbuffers::String *pubKey,
-                                           const flatbuffers::String *ln,
-                                           const flatbuffers::String *dn,
-                                           const flatbuffers::String *an,
-                                           bool uncommitted, MDB_env *env) {
+                                     const flatbuffers::String *ln,
+                                     const flatbuffers::String *dn,
+                                     const flatbuffers::String *an,
+                                     bool uncommitted, MDB_env *env) {
+  // uncommitted balances may be cached
+  if (uncommitted) flush();
+  return read_account_asset(pubKey, ln, dn, an, uncommitted, env);
+}
+
+::iroha::Asset *WSV::read_account_asset(const flatbuffers::String *pubKey,
+                                        const flatbuffers::String *ln,
+                                        const flatbuffers::String *dn,
+                                        const flatbuffers::String *an,
+                                        bool uncommitted, MDB_env *env) {
   MDB_val c_key, c_val;
   MDB_cursor *cursor;
   MDB_txn *tx;
@@ -739,7 +1000,7 @@ void WSV::permisson_remove(const iroha::PermissionRemove *command) {}
     c_val.mv_data = (void *)blob->second.data();
     c_val.mv_size = blob->second.size();
   } else {
-    throw exception::InvalidTransaction::ASSET_NOT_FOUND;
+    return nullptr;
   }
 
   // depending on 'uncommitted' we use RO or RW transaction
@@ -775,20 +1036,13 @@ void WSV::permisson_remove(const iroha::PermissionRemove *command) {}
   fflush(stdout);
   */
 
-  auto q_a = flatbuffers::GetRoot<::iroha::Asset>(c_val.mv_data)->asset_as_Currency();
-  // if sender has no such asset, then it is incorrect transaction
-  if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_GET_BOTH ))) {
-    if (res == MDB_NOTFOUND) {
-      throw exception::InvalidTransaction::ASSET_NOT_FOUND;
-    }
-    AMETSUCHI_CRITICAL(res, EINVAL);
-  }
-
+  // account may have no such asset
+  ::iroha::Asset *ret = nullptr;
   MDB_val r_key, r_val;
-  if ((res = mdb_cursor_get(cursor, &r_key, &r_val, MDB_GET_CURRENT ))) {
-    if (res == MDB_NOTFOUND) {
-      throw exception::InvalidTransaction::ASSET_NOT_FOUND;
-    }
+  if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_GET_BOTH)) == 0 &&
+      (res = mdb_cursor_get(cursor, &r_key, &r_val, MDB_GET_CURRENT)) == 0) {
+    ret = flatbuffers::GetMutableRoot<::iroha::Asset>(r_val.mv_data);
+  } else if (res != MDB_NOTFOUND) {
     AMETSUCHI_CRITICAL(res, EINVAL);
   }
 
@@ -796,7 +1050,7 @@ void WSV::permisson_remove(const iroha::PermissionRemove *command) {}
     mdb_cursor_close(cursor);
     mdb_txn_abort(tx);
   }
-  return flatbuffers::GetMutableRoot<::iroha::Asset>(r_val.mv_data);
+  return ret;
 }
 
 // asset_id is asset_name + domain_name + ledger_name
@@ -829,11 +1083,11 @@ const ::iroha::Asset *WSV::assetidGetAsset(const std::string &&assetid,
     }
   }
 
-  // if pubKey is not fount, throw exception
-  if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET))) {
-    if (res == MDB_NOTFOUND) {
-      throw exception::InvalidTransaction::ASSET_NOT_FOUND;
-    }
+  // asset may be not created
+  const ::iroha::Asset *ret = nullptr;
+  if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET)) == 0) {
+    ret = flatbuffers::GetRoot<::iroha::Asset>(c_val.mv_data);
+  } else if (res != MDB_NOTFOUND) {
     AMETSUCHI_CRITICAL(res, EINVAL);
   }
 
@@ -841,7 +1095,7 @@ const ::iroha::Asset *WSV::assetidGetAsset(const std::string &&assetid,
     mdb_cursor_close(cursor);
     mdb_txn_abort(tx);
   }
-  return flatbuffers::GetRoot<::iroha::Asset>(c_val.mv_data);
+  return ret;
 }
 
 std::vector<const ::iroha::Asset *> WSV::accountGetAllAssets(
@@ -856,6 +1110,8 @@ std::vector<const ::iroha::Asset *> WSV::accountGetAllAssets(
   c_key.mv_size = pubKey->size();
 
   if (uncommitted) {
+    // uncommitted balances may be cached
+    flush();
     cursor = trees_.at("wsv_pubkey_assets").second;
     tx = append_tx_;
   } else {
@@ -873,26 +1129,21 @@ std::vector<const ::iroha::Asset *> WSV::accountGetAllAssets(
     }
   }
 
-  // if sender has no such asset, then it is incorrect transaction
-  if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET))) {
-    if (res == MDB_NOTFOUND) return std::vector<const ::iroha::Asset *>{};
-    AMETSUCHI_CRITICAL(res, EINVAL);
-  }
-
   std::vector<const ::iroha::Asset *> ret;
   // account has assets. try to find asset with the same `pk`
   // iterate over account's assets, O(N), where N is number of different
-  // assets,
-  do {
+  // assets, account may have no assets at all
+  res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET);
+  while (res == 0) {
     // user's current amount
     ret.push_back(flatbuffers::GetRoot<::iroha::Asset>(c_val.mv_data));
 
     // move to next asset in user's account
-    if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_NEXT_DUP))) {
-      if (res == MDB_NOTFOUND) return ret;
-      AMETSUCHI_CRITICAL(res, EINVAL);
-    }
-  } while (res == 0);
+    res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_NEXT_DUP);
+  }
+  if (res != MDB_NOTFOUND) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
 
   if (!uncommitted) {
     mdb_cursor_close(cursor);
@@ -912,10 +1163,10 @@ const std::vector<const ::iroha::AccountPermissionLedger*> WSV::accountGetPermis
   c_key.mv_data = (void *)(pubKey->data());
   c_key.mv_size = pubKey->size();
 
+  // account may be not added, it has no permissions then
   auto cursor = trees_.at("wsv_pubkey_account").second;
   if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET))) {
-    if (res == MDB_NOTFOUND)
-      throw exception::InvalidTransaction::ACCOUNT_NOT_FOUND;
+    if (res == MDB_NOTFOUND) return permission_vec;
 
     AMETSUCHI_CRITICAL(res, EINVAL);
   }
@@ -936,10 +1187,10 @@ const std::vector<const ::iroha::AccountPermissionDomain*> WSV::accountGetPermis
   c_key.mv_data = (void *)(pubKey->data());
   c_key.mv_size = pubKey->size();
 
+  // account may be not added, it has no permissions then
   auto cursor = trees_.at("wsv_pubkey_account").second;
   if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET))) {
-    if (res == MDB_NOTFOUND)
-      throw exception::InvalidTransaction::ACCOUNT_NOT_FOUND;
+    if (res == MDB_NOTFOUND) return permission_vec;
 
     AMETSUCHI_CRITICAL(res, EINVAL);
   }
@@ -960,10 +1211,10 @@ const std::vector<const ::iroha::AccountPermissionAsset*>  WSV::accountGetPermis
   c_key.mv_data = (void *)(pubKey->data());
   c_key.mv_size = pubKey->size();
 
+  // account may be not added, it has no permissions then
   auto cursor = trees_.at("wsv_pubkey_account").second;
   if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET))) {
-    if (res == MDB_NOTFOUND)
-      throw exception::InvalidTransaction::ACCOUNT_NOT_FOUND;
+    if (res == MDB_NOTFOUND) return permission_vec;
 
     AMETSUCHI_CRITICAL(res, EINVAL);
   }
@@ -1006,11 +1257,80 @@ const ::iroha::Peer *WSV::pubKeyGetPeer(const flatbuffers::String *pubKey,
     }
   }
 
-  // if pubKey is not fount, throw exception
-  if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET))) {
-    if (res == MDB_NOTFOUND) {
-      throw exception::InvalidTransaction::PEER_NOT_FOUND;
+  // peer may be not added
+  const ::iroha::Peer *ret = nullptr;
+  if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET)) == 0) {
+    ret = flatbuffers::GetRoot<::iroha::Peer>(c_val.mv_data);
+  } else if (res != MDB_NOTFOUND) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  if (!uncommitted) {
+    mdb_cursor_close(cursor);
+    mdb_txn_abort(tx);
+  }
+  return ret;
+}
+
+::iroha::Asset *WSV::accountGetAssetAt(const flatbuffers::String *pubKey,
+                                       const flatbuffers::String *ln,
+                                       const flatbuffers::String *dn,
+                                       const flatbuffers::String *an,
+                                       size_t height, bool uncommitted,
+                                       MDB_env *env) {
+  MDB_val c_key, c_val;
+  MDB_cursor *cursor;
+  MDB_txn *tx;
+  int res;
+
+  auto key = balance_history_key(pubKey->str(),
+                                 ln->str() + dn->str() + an->str(), height);
+  // versions of the same balance share everything except height
+  auto prefix = key.substr(0, key.size() - sizeof(uint64_t));
+
+  if (uncommitted) {
+    // uncommitted versions may be cached
+    flush();
+    cursor = trees_.at("wsv_balance_history").second;
+    tx = append_tx_;
+  } else {
+    // create read-only transaction, create new RO cursor
+    if ((res = mdb_txn_begin(env, NULL, MDB_RDONLY, &tx))) {
+      AMETSUCHI_CRITICAL(res, MDB_PANIC);
+      AMETSUCHI_CRITICAL(res, MDB_MAP_RESIZED);
+      AMETSUCHI_CRITICAL(res, MDB_READERS_FULL);
+      AMETSUCHI_CRITICAL(res, ENOMEM);
+    }
+
+    if ((res = mdb_cursor_open(tx, trees_.at("wsv_balance_history").first,
+                               &cursor))) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+  }
+
+  // the latest version at or before height: either the key itself, or the
+  // previous one of the first key greater than it
+  c_key.mv_data = (void *)key.data();
+  c_key.mv_size = key.size();
+  res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET_RANGE);
+  if (res == 0) {
+    if (c_key.mv_size != key.size() ||
+        std::memcmp(c_key.mv_data, key.data(), key.size()) != 0) {
+      res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_PREV);
+    }
+  } else if (res == MDB_NOTFOUND) {
+    res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_LAST);
+  }
+
+  ::iroha::Asset *ret = nullptr;
+  if (res == 0) {
+    // version must belong to the same account and asset
+    if (c_key.mv_size == prefix.size() + sizeof(uint64_t) &&
+        std::memcmp(c_key.mv_data, prefix.data(), prefix.size()) == 0 &&
+        c_val.mv_size > 0) {
+      ret = flatbuffers::GetMutableRoot<::iroha::Asset>(c_val.mv_data);
     }
+  } else if (res != MDB_NOTFOUND) {
     AMETSUCHI_CRITICAL(res, EINVAL);
   }
 
@@ -1018,7 +1338,65 @@ const ::iroha::Peer *WSV::pubKeyGetPeer(const flatbuffers::String *pubKey,
     mdb_cursor_close(cursor);
     mdb_txn_abort(tx);
   }
-  return flatbuffers::GetRoot<::iroha::Peer>(c_val.mv_data);
+  return ret;
+}
+
+AssetStats WSV::assetGetStats(const std::string &assetid, bool uncommitted,
+                              MDB_env *env) {
+  MDB_val c_key, c_val;
+  MDB_cursor *cursor;
+  MDB_txn *tx;
+  int res;
+
+  AssetStats ret{0, 0, 0};
+
+  auto blob = created_assets_.find(assetid);
+  if (blob == created_assets_.end()) {
+    return ret;
+  }
+  ret.precision = flatbuffers::GetRoot<::iroha::Asset>(blob->second.data())
+                      ->asset_as_Currency()
+                      ->precision();
+
+  if (uncommitted) {
+    // uncommitted aggregates may be cached
+    flush();
+    cursor = trees_.at("wsv_assetid_stats").second;
+    tx = append_tx_;
+  } else {
+    // create read-only transaction, create new RO cursor
+    if ((res = mdb_txn_begin(env, NULL, MDB_RDONLY, &tx))) {
+      AMETSUCHI_CRITICAL(res, MDB_PANIC);
+      AMETSUCHI_CRITICAL(res, MDB_MAP_RESIZED);
+      AMETSUCHI_CRITICAL(res, MDB_READERS_FULL);
+      AMETSUCHI_CRITICAL(res, ENOMEM);
+    }
+
+    if ((res = mdb_cursor_open(tx, trees_.at("wsv_assetid_stats").first,
+                               &cursor))) {
+      AMETSUCHI_CRITICAL(res, EINVAL);
+    }
+  }
+
+  c_key.mv_data = (void *)assetid.data();
+  c_key.mv_size = assetid.size();
+
+  // asset may be created, but not committed yet
+  if ((res = mdb_cursor_get(cursor, &c_key, &c_val, MDB_SET)) == 0) {
+    int64_t holders;
+    std::memcpy(&ret.total_supply, c_val.mv_data, sizeof(__int128_t));
+    std::memcpy(&holders, (char *)c_val.mv_data + sizeof(__int128_t),
+                sizeof(int64_t));
+    ret.holders = holders;
+  } else if (res != MDB_NOTFOUND) {
+    AMETSUCHI_CRITICAL(res, EINVAL);
+  }
+
+  if (!uncommitted) {
+    mdb_cursor_close(cursor);
+    mdb_txn_abort(tx);
+  }
+  return ret;
 }
 
 void WSV::close_dbi(MDB_env *env) {
@@ -1028,7 +1406,7 @@ void WSV::close_dbi(MDB_env *env) {
   }
 }
 uint32_t WSV::get_trees_total() {
-  wsv_trees_total = 4;
+  wsv_trees_total = 6;
   return wsv_trees_total;
 }
 }
@@ -67,6 +67,46 @@ size_t IrohaConfigManager::getPoolWorkerQueueSize(size_t defaultValue) {
   return this->getParam<size_t>({"pool_worker_queue_size"}, defaultValue);
 }
 
+size_t IrohaConfigManager::getPanicTimeoutMinMs(size_t defaultValue) {
+  return this->getParam<size_t>({"panic_timeout_min_ms"}, defaultValue);
+}
+
+size_t IrohaConfigManager::getPanicTimeoutMaxMs(size_t defaultValue) {
+  return this->getParam<size_t>({"panic_timeout_max_ms"}, defaultValue);
+}
+
+double IrohaConfigManager::getPanicTimeoutFactor(double defaultValue) {
+  return this->getParam<double>({"panic_timeout_factor"}, defaultValue);
+}
+
+size_t IrohaConfigManager::getConsensusWindow(size_t defaultValue) {
+  return this->getParam<size_t>({"consensus_window"}, defaultValue);
+}
+
+size_t IrohaConfigManager::getLeaderRotation(size_t defaultValue) {
+  return this->getParam<size_t>({"leader_rotation"}, defaultValue);
+}
+
+size_t IrohaConfigManager::getCommitCacheSize(size_t defaultValue) {
+  return this->getParam<size_t>({"commit_cache_size"}, defaultValue);
+}
+
+size_t IrohaConfigManager::getDecisionHistory(size_t defaultValue) {
+  return this->getParam<size_t>({"decision_history"}, defaultValue);
+}
+
+size_t IrohaConfigManager::getMempoolMaxTransactions(size_t defaultValue) {
+  return this->getParam<size_t>({"mempool_max_transactions"}, defaultValue);
+}
+
+size_t IrohaConfigManager::getMempoolMaxBytes(size_t defaultValue) {
+  return this->getParam<size_t>({"mempool_max_bytes"}, defaultValue);
+}
+
+size_t IrohaConfigManager::getMempoolMaxPerCreator(size_t defaultValue) {
+  return this->getParam<size_t>({"mempool_max_per_creator"}, defaultValue);
+}
+
 uint16_t IrohaConfigManager::getGrpcPortNumber(uint16_t defaultValue) {
   return this->getParam<uint16_t>({"grpc_port"}, defaultValue);
 }
@@ -38,6 +38,22 @@ class IrohaConfigManager : public AbstractConfigManager {
   size_t getConcurrency(size_t defaultValue);
   size_t getMaxFaultyPeers(size_t defaultValue);
   size_t getPoolWorkerQueueSize(size_t defaultValue);
+  // bounds of the consensus panic timeout and its factor over p99 latency
+  size_t getPanicTimeoutMinMs(size_t defaultValue);
+  size_t getPanicTimeoutMaxMs(size_t defaultValue);
+  double getPanicTimeoutFactor(double defaultValue);
+  // consensus rounds, which may be undecided at the same time
+  size_t getConsensusWindow(size_t defaultValue);
+  // orders given by one leader before the next peer leads, 0 - no rotation
+  size_t getLeaderRotation(size_t defaultValue);
+  // committed events remembered to drop duplicate COMMITs
+  size_t getCommitCacheSize(size_t defaultValue);
+  // applied COMMITs kept for peers, which missed them
+  size_t getDecisionHistory(size_t defaultValue);
+  // bounds of the mempool of transactions received by Torii
+  size_t getMempoolMaxTransactions(size_t defaultValue);
+  size_t getMempoolMaxBytes(size_t defaultValue);
+  size_t getMempoolMaxPerCreator(size_t defaultValue);
   uint16_t getGrpcPortNumber(uint16_t defaultValue);
   uint16_t getHttpPortNumber(uint16_t defaultValue);
   bool getActiveStart(bool defaultValue);
@@ -32,7 +32,10 @@ limitations under the License.
 #include <main_generated.h>
 
 #include <asset_generated.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include <algorithm>
+#include <cstdio>
 #include <memory>
 #include <iostream>
 #include <string>
@@ -62,6 +65,15 @@ using grpc::ServerContext;
 using grpc::ClientContext;
 using grpc::Status;
 
+// size of a file chunk in fetchSnapshot stream, bytes
+static const size_t SNAPSHOT_CHUNK_SIZE = 1024 * 1024;
+// limits of a batch in fetchStreamTransaction stream, a batch is sent when
+// either of them is reached
+static const size_t STREAM_BATCH_TRANSACTIONS = 64;
+static const size_t STREAM_BATCH_SIZE = 1024 * 1024;
+// metadata of Torii call with ip of the peer, which forwards the transaction
+static const std::string FORWARDED_BY = "iroha-forwarded-by";
+
 /**
  * Enum
  */
@@ -143,7 +155,7 @@ void receive(Verify::CallBackFunc &&callback) {
 namespace iroha {
 namespace SumeragiImpl {
 namespace Torii {
-Receiver<Torii::CallBackFunc> receiver;
+ReceiverWithReturen<Torii::CallBackFunc, ::iroha::Code> receiver;
 
 void receive(Torii::CallBackFunc &&callback) {
   receiver.set(std::move(callback));
@@ -171,10 +183,13 @@ class SumeragiConnectionClient {
     logger::info("connection") << "Operation";
     logger::info("connection")
         << "size: " << consensusEvent.peerSignatures()->size();
-    logger::info("connection")
-        << "Transaction: "
-        << flatbuffer_service::toString(
-               *consensusEvent.transactions()->Get(0)->tx_nested_root());
+    // abort event has no transactions
+    if (consensusEvent.transactions()->size() > 0) {
+      logger::info("connection")
+          << "Transaction: "
+          << flatbuffer_service::toString(
+                 *consensusEvent.transactions()->Get(0)->tx_nested_root());
+    }
 
     flatbuffers::FlatBufferBuilder fbb;
 
@@ -213,6 +228,9 @@ class SumeragiConnectionClient {
     logger::info("connection") << "tx: " << flatbuffer_service::toString(tx);
 
     ::grpc::ClientContext clientContext;
+    // receiver tells a forwarded transaction from a client's one
+    clientContext.AddMetadata(FORWARDED_BY,
+                              config::PeerServiceConfig::getInstance().getMyIp());
     flatbuffers::FlatBufferBuilder xbb;
 
     auto txOffset = flatbuffer_service::copyTransaction(xbb, tx);
@@ -272,11 +290,13 @@ class SumeragiConnectionServiceImpl final : public ::iroha::Sumeragi::Service {
           from, std::move(fbb.ReleaseBufferPointer()));
     }
 
+    // abort event has no transactions
+    const auto txs = request->GetRoot()->transactions();
     auto tx_str =
-        flatbuffer_service::toString(*request->GetRoot()
-                                          ->transactions()
-                                          ->Get(0)  // Future work: #(tx) = 1
-                                          ->tx_nested_root());
+        txs == nullptr || txs->size() == 0
+            ? std::string()
+            : flatbuffer_service::toString(
+                  *txs->Get(0)->tx_nested_root());  // Future work: #(tx) = 1
     auto responseOffset = ::iroha::CreateResponseDirect(
         fbbResponse, "OK!!", ::iroha::Code::UNDECIDED,
         flatbuffer_service::primitives::CreateSignature(fbbResponse, tx_str,
@@ -299,6 +319,7 @@ class SumeragiConnectionServiceImpl final : public ::iroha::Sumeragi::Service {
     // SumeragiConnectionServiceImpl::Torii() method.
     fbbResponse.Clear();
 
+    ::iroha::Code code;
     {
       const auto tx = txRef->GetRoot();
       flatbuffers::FlatBufferBuilder fbb;
@@ -316,15 +337,21 @@ class SumeragiConnectionServiceImpl final : public ::iroha::Sumeragi::Service {
       }
 
       fbb.Finish(txoffset.value());
-      connection::iroha::SumeragiImpl::Torii::receiver.invoke(
-          "from",  // TODO: Specify 'from'
-          fbb.ReleaseBufferPointer());
+      // set by a peer, which forwards the transaction, clients do not set it
+      std::string from;
+      auto forwardedBy = context->client_metadata().find(FORWARDED_BY);
+      if (forwardedBy != context->client_metadata().end()) {
+        from.assign(forwardedBy->second.data(), forwardedBy->second.size());
+      }
+      code = connection::iroha::SumeragiImpl::Torii::receiver.invoke(
+          from, fbb.ReleaseBufferPointer());
     }
 
     auto tx_str = flatbuffer_service::toString(*txRef->GetRoot());
 
+    // BUSY is not an RPC error, client is expected to retry later
     auto responseOffset = ::iroha::CreateResponseDirect(
-        fbbResponse, "OK!!", ::iroha::Code::UNDECIDED,
+        fbbResponse, code == ::iroha::Code::BUSY ? "BUSY" : "OK!!", code,
         flatbuffer_service::primitives::CreateSignature(fbbResponse, tx_str,
                                                         datetime::unixtime()));
 
@@ -503,10 +530,19 @@ bool send(const std::string &ip, const ::iroha::Transaction &tx) {
         grpc::InsecureChannelCredentials()));
 
     flatbuffers::BufferRef<Response> response;
-    client.Torii(tx, &response);
+    auto handler = client.Torii(tx, &response);
+    if (!handler) {
+      logger::error("connection") << handler.error();
+      return false;
+    }
     auto reply = response.GetRoot();
+    if (reply->code() == ::iroha::Code::BUSY) {
+      logger::info("connection") << ip << " is busy, retry later";
+      return false;
+    }
     return true;
   }
+  return false;
 }
 }  // namespace Torii
 }  // namespace SumeragiImpl
@@ -527,6 +563,14 @@ void receive(AccountGetAsset::CallBackFunc &&callback) {
   receiver.set(std::move(callback));
 }
 }  // namespace AccountGetAsset
+namespace AssetGetStats {
+ReceiverWithReturen<AssetGetStats::CallBackFunc, AssetGetStats::Stats>
+    receiver;
+
+void receive(AssetGetStats::CallBackFunc &&callback) {
+  receiver.set(std::move(callback));
+}
+}  // namespace AssetGetStats
 }  // namespace AssetRepositoryImpl
 }  // namespace iroha
 /**
@@ -585,6 +629,47 @@ class AssetRepositoryConnectionServiceImpl final
     return Status::OK;
   }
 
+  Status AssetGetStats(
+      ServerContext *context,
+      const flatbuffers::BufferRef<::iroha::AssetQuery> *requestRef,
+      flatbuffers::BufferRef<::iroha::AssetStatsResponse> *responseRef
+  ) override {
+    fbbResponse.Clear();
+    {
+      const auto q = requestRef->GetRoot();
+      if (q->ledger_name() == nullptr || q->domain_name() == nullptr ||
+          q->asset_name() == nullptr) {
+        auto responseOffset = ::iroha::CreateAssetStatsResponseDirect(
+            fbbResponse, "Asset is not specified", ::iroha::Code::FAIL);
+        fbbResponse.Finish(responseOffset);
+
+        *responseRef = flatbuffers::BufferRef<::iroha::AssetStatsResponse>(
+            fbbResponse.GetBufferPointer(), fbbResponse.GetSize());
+        return Status::CANCELLED;
+      }
+
+      flatbuffers::FlatBufferBuilder fbb;
+      auto req_offset = ::iroha::CreateAssetQueryDirect(
+          fbb, "", q->ledger_name()->c_str(), q->domain_name()->c_str(),
+          q->asset_name()->c_str(), q->uncommitted());
+
+      fbb.Finish(req_offset);
+      auto stats =
+          connection::iroha::AssetRepositoryImpl::AssetGetStats::receiver
+              .invoke("from",  // TODO: Specify 'from'
+                      fbb.ReleaseBufferPointer());
+
+      auto responseOffset = ::iroha::CreateAssetStatsResponseDirect(
+          fbbResponse, "Success", ::iroha::Code::COMMIT,
+          stats.total_supply.c_str(), stats.holders, stats.precision);
+      fbbResponse.Finish(responseOffset);
+
+      *responseRef = flatbuffers::BufferRef<::iroha::AssetStatsResponse>(
+          fbbResponse.GetBufferPointer(), fbbResponse.GetSize());
+    }
+    return Status::OK;
+  }
+
  private:
   flatbuffers::Offset<::iroha::Signature> sign(
       flatbuffers::FlatBufferBuilder &fbb, const std::string &tx) {
@@ -613,13 +698,21 @@ namespace SyncImpl {
 namespace getTransactions {
 // ToDo more clear
 ReceiverWithReturen<getTransactions::CallBackFunc,
-        std::vector<const ::iroha::Transaction *>
+        std::vector<std::shared_ptr<const ::iroha::Transaction>>
 > receiver;
 void receive(getTransactions::CallBackFunc &&callback) {
     receiver.set(std::move(callback));
 }
 }  // namespace getTransactions
 
+namespace fetchSnapshot {
+ReceiverWithReturen<fetchSnapshot::CallBackFunc, fetchSnapshot::Snapshot>
+    receiver;
+void receive(fetchSnapshot::CallBackFunc &&callback) {
+  receiver.set(std::move(callback));
+}
+}  // namespace fetchSnapshot
+
 }  // namespace SyncImpl
 }  // namespace memberShipService
 
@@ -632,8 +725,10 @@ class SyncConnectionClient {
     ::grpc::ClientContext clientContext;
     flatbuffers::FlatBufferBuilder fbbPing;
 
-    auto pingOffset = ::iroha::CreatePingDirect(
-        fbbPing, ping.message()->c_str(), ping.sender()->c_str());
+    // root is binary, it is copied with its size
+    auto pingOffset = ::iroha::CreatePing(
+        fbbPing, fbbPing.CreateString(ping.message()->str()),
+        fbbPing.CreateString(ping.sender()->str()), ping.index());
     fbbPing.Finish(pingOffset);
 
     flatbuffers::BufferRef<::iroha::Ping> reqPingRef(fbbPing.GetBufferPointer(),
@@ -687,6 +782,107 @@ class SyncConnectionClient {
     }
   }
 
+  size_t fetchStreamTransaction(const ::iroha::Ping &ping) const {
+    ::grpc::ClientContext clientContext;
+    flatbuffers::FlatBufferBuilder fbbPing;
+
+    auto pingOffset = ::iroha::CreatePingDirect(
+        fbbPing, ping.message()->c_str(), ping.sender()->c_str(),
+        ping.index(), ping.count());
+    fbbPing.Finish(pingOffset);
+
+    flatbuffers::BufferRef<::iroha::Ping> reqPingRef(fbbPing.GetBufferPointer(),
+                                                     fbbPing.GetSize());
+
+    auto reader = stub_->fetchStreamTransaction(&clientContext, reqPingRef);
+    flatbuffers::BufferRef<TransactionResponse> batchRef;
+    size_t received = 0;
+    bool accepted = true;
+    while (accepted && reader->Read(&batchRef)) {
+      auto batch = batchRef.GetRoot();
+      if (batch->transactions() == nullptr) continue;
+      size_t index = batch->index();
+      for (auto &&tx : *batch->transactions()) {
+        // transaction is copied, batch buffer is reused by the next Read
+        accepted = ::peer::sync::detail::append_temporary(index++, tx);
+        if (!accepted) break;
+        received++;
+      }
+    }
+    if (!accepted) {
+      clientContext.TryCancel();
+    }
+
+    auto res = reader->Finish();
+    if (!res.ok() && accepted) {
+      logger::error("connection")
+          << static_cast<int>(res.error_code()) << ": " << res.error_message();
+    }
+    logger::info("connection") << "received " << received << " transactions";
+    return received;
+  }
+
+  memberShipService::SyncImpl::fetchSnapshot::Snapshot fetchSnapshot(
+      const ::iroha::Ping &ping, const std::string &folder) const {
+    ::grpc::ClientContext clientContext;
+    flatbuffers::FlatBufferBuilder fbbPing;
+
+    auto pingOffset = ::iroha::CreatePingDirect(
+        fbbPing, ping.message()->c_str(), ping.sender()->c_str());
+    fbbPing.Finish(pingOffset);
+
+    flatbuffers::BufferRef<::iroha::Ping> reqPingRef(fbbPing.GetBufferPointer(),
+                                                     fbbPing.GetSize());
+
+    memberShipService::SyncImpl::fetchSnapshot::Snapshot snapshot{folder, 0,
+                                                                  ""};
+    auto reader = stub_->fetchSnapshot(&clientContext, reqPingRef);
+    flatbuffers::BufferRef<::iroha::SnapshotChunk> chunkRef;
+    bool written = true;
+    while (written && reader->Read(&chunkRef)) {
+      auto chunk = chunkRef.GetRoot();
+      auto file = chunk->file()->str();
+      // files are written only inside of the snapshot folder
+      if (file.empty() || file.front() == '/' ||
+          file.find("..") != std::string::npos) {
+        logger::error("connection") << "wrong snapshot file: " << file;
+        written = false;
+        break;
+      }
+
+      auto slash = file.rfind('/');
+      if (slash != std::string::npos) {
+        mkdir((folder + file.substr(0, slash)).c_str(), 0700);
+      }
+      // the first chunk of a file truncates it
+      auto fp = std::fopen((folder + file).c_str(),
+                           chunk->offset() == 0 ? "wb" : "r+b");
+      written = fp != nullptr &&
+                std::fseek(fp, chunk->offset(), SEEK_SET) == 0 &&
+                (chunk->data() == nullptr ||
+                 std::fwrite(chunk->data()->data(), 1, chunk->data()->size(),
+                             fp) == chunk->data()->size());
+      if (fp != nullptr) std::fclose(fp);
+
+      snapshot.height = chunk->height();
+      if (chunk->root() != nullptr) {
+        snapshot.root.assign(chunk->root()->begin(), chunk->root()->end());
+      }
+    }
+    if (!written) {
+      clientContext.TryCancel();
+    }
+
+    auto res = reader->Finish();
+    logger::info("Connection with grpc") << "Send!";
+    if (!res.ok() || !written) {
+      logger::error("connection")
+          << static_cast<int>(res.error_code()) << ": " << res.error_message();
+      snapshot.folder.clear();
+    }
+    return snapshot;
+  }
+
   std::vector<uint8_t> getPeers(const ::iroha::Ping &ping) const {
     ::grpc::ClientContext clientContext;
 
@@ -731,8 +927,11 @@ class SyncConnectionServiceImpl final : public ::iroha::Sync::Service {
     {
       logger::debug("SyncConnectionServiceImpl::checkHash") << "RPC works";
       std::string hash = request->GetRoot()->message()->str();
-      // Now, only supported root hash copare. (ver1.0)
-      if (repository::getMerkleRoot() == hash) {
+      auto index = request->GetRoot()->index();
+      // root at the given height, or the current one
+      auto root = index == 0 ? repository::getMerkleRoot()
+                             : repository::getMerkleRoot(index);
+      if (!root.empty() && root == hash) {
         auto responseOffset =
             ::iroha::CreateCheckHashResponse(fbbResponse, true, true, true);
         fbbResponse.Finish(responseOffset);
@@ -751,7 +950,7 @@ class SyncConnectionServiceImpl final : public ::iroha::Sync::Service {
         ServerContext *context, const flatbuffers::BufferRef<Ping> *requestRef,
         flatbuffers::BufferRef<::iroha::TransactionResponse> *responseRef) override {
         fbbResponse.Clear();
-        std::vector<const ::iroha::Transaction*> transactions;
+        std::vector<std::shared_ptr<const ::iroha::Transaction>> transactions;
         {
             const auto q = requestRef->GetRoot();
             flatbuffers::FlatBufferBuilder fbb;
@@ -766,7 +965,7 @@ class SyncConnectionServiceImpl final : public ::iroha::Sync::Service {
             std::vector<uint8_t> types;
             std::vector<flatbuffers::Offset<::iroha::Transaction>> res_txs;
             {
-                for (const ::iroha::Transaction *transaction : transactions) {
+                for (auto &&transaction : transactions) {
                     auto ntx = flatbuffer_service::copyTransaction(fbbResponse,*transaction);
                     if(ntx){
                         res_txs.emplace_back(ntx.value());
@@ -782,6 +981,112 @@ class SyncConnectionServiceImpl final : public ::iroha::Sync::Service {
             *responseRef = flatbuffers::BufferRef<TransactionResponse>(
                     fbbResponse.GetBufferPointer(), fbbResponse.GetSize());
         }
+        return Status::OK;
+  }
+
+  Status fetchStreamTransaction(
+      ServerContext *context, const flatbuffers::BufferRef<Ping> *requestRef,
+      grpc::ServerWriter<flatbuffers::BufferRef<TransactionResponse>> *writer)
+      override {
+    logger::debug("SyncConnectionServiceImpl::fetchStreamTransaction")
+        << "RPC works";
+    const auto q = requestRef->GetRoot();
+    size_t index = std::max<size_t>(q->index(), 1);
+    // transactions committed after the call started are left for next call
+    size_t height = repository::getHeight();
+    if (q->count() != 0) {
+      height = std::min<size_t>(height, index + q->count() - 1);
+    }
+
+    flatbuffers::FlatBufferBuilder fbbBatch;
+    std::vector<flatbuffers::Offset<Transaction>> txs;
+    while (index <= height) {
+      fbbBatch.Clear();
+      txs.clear();
+      const size_t first = index;
+      while (index <= height && txs.size() < STREAM_BATCH_TRANSACTIONS &&
+             fbbBatch.GetSize() < STREAM_BATCH_SIZE) {
+        auto tx = repository::getTransaction(index);
+        auto ntx = flatbuffer_service::copyTransaction(fbbBatch, *tx);
+        if (!ntx) {
+          return Status(grpc::StatusCode::INTERNAL,
+                        "can not copy transaction " + std::to_string(index));
+        }
+        txs.emplace_back(ntx.value());
+        index++;
+      }
+      fbbBatch.Finish(::iroha::CreateTransactionResponseDirect(
+          fbbBatch, "Success", first, ::iroha::Code::COMMIT, &txs));
+
+      // Write blocks while the client does not read, so a slow client
+      // throttles the server instead of buffering the whole ledger
+      if (context->IsCancelled() ||
+          !writer->Write(flatbuffers::BufferRef<TransactionResponse>(
+              fbbBatch.GetBufferPointer(), fbbBatch.GetSize()))) {
+        return Status(grpc::StatusCode::CANCELLED, "client is gone");
+      }
+    }
+    return Status::OK;
+  }
+
+  Status fetchSnapshot(
+      ServerContext *context, const flatbuffers::BufferRef<Ping> *requestRef,
+      grpc::ServerWriter<flatbuffers::BufferRef<::iroha::SnapshotChunk>>
+          *writer) override {
+    logger::debug("SyncConnectionServiceImpl::fetchSnapshot") << "RPC works";
+    const auto q = requestRef->GetRoot();
+    flatbuffers::FlatBufferBuilder fbb;
+    fbb.Finish(::iroha::CreatePingDirect(fbb, q->message()->c_str(),
+                                         q->sender()->c_str()));
+
+    auto snapshot =
+        connection::memberShipService::SyncImpl::fetchSnapshot::receiver
+            .invoke("from",  // TODO: Specify 'from'
+                    fbb.ReleaseBufferPointer());
+    if (snapshot.folder.empty()) {
+      return Status(grpc::StatusCode::UNAVAILABLE, "no snapshot");
+    }
+
+    // main environment and environments of WSV shards
+    std::vector<std::string> files{"data.mdb"};
+    if (auto dir = opendir(snapshot.folder.c_str())) {
+      while (auto entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.compare(0, 10, "wsv_shard_") == 0) {
+          files.push_back(name + "/data.mdb");
+        }
+      }
+      closedir(dir);
+    }
+
+    std::vector<uint8_t> root(snapshot.root.begin(), snapshot.root.end());
+    std::vector<uint8_t> data(SNAPSHOT_CHUNK_SIZE);
+    flatbuffers::FlatBufferBuilder fbbChunk;
+    for (auto &&file : files) {
+      auto fp = std::fopen((snapshot.folder + file).c_str(), "rb");
+      if (fp == nullptr) {
+        return Status(grpc::StatusCode::INTERNAL, "can not read " + file);
+      }
+
+      uint64_t offset = 0;
+      size_t size;
+      // empty file is sent as a single empty chunk
+      do {
+        size = std::fread(data.data(), 1, data.size(), fp);
+        std::vector<uint8_t> chunk(data.begin(), data.begin() + size);
+        fbbChunk.Clear();
+        fbbChunk.Finish(::iroha::CreateSnapshotChunkDirect(
+            fbbChunk, snapshot.height, &root, file.c_str(), offset, &chunk));
+        if (!writer->Write(flatbuffers::BufferRef<::iroha::SnapshotChunk>(
+                fbbChunk.GetBufferPointer(), fbbChunk.GetSize()))) {
+          std::fclose(fp);
+          return Status(grpc::StatusCode::CANCELLED, "client is gone");
+        }
+        offset += size;
+      } while (size == data.size());
+      std::fclose(fp);
+    }
+    return Status::OK;
   }
 
   Status getPeers(
@@ -817,6 +1122,40 @@ class SyncConnectionServiceImpl final : public ::iroha::Sync::Service {
 
 namespace memberShipService {
     namespace SyncImpl {
+        namespace fetchSnapshot {
+            Snapshot send(const std::string &ip, const ::iroha::Ping &ping,
+                          const std::string &folder) {
+                logger::info("Connection with grpc") << "fetchSnapshot Send!";
+                logger::info("Connection with grpc") << "IP: " << ip;
+                SyncConnectionClient client(grpc::CreateChannel(
+                        ip + ":" +
+                        std::to_string(config::IrohaConfigManager::getInstance()
+                                               .getGrpcPortNumber(50051)),
+                        grpc::InsecureChannelCredentials()));
+
+                std::string target = folder;
+                if (target.empty() || target.back() != '/') {
+                    target += '/';
+                }
+                mkdir(target.c_str(), 0700);
+                return client.fetchSnapshot(ping, target);
+            }
+        }  // namespace fetchSnapshot
+
+        namespace fetchStreamTransaction {
+            size_t send(const std::string &ip, const ::iroha::Ping &ping) {
+                logger::info("Connection with grpc") << "fetchStreamTransaction Send!";
+                logger::info("Connection with grpc") << "IP: " << ip;
+                SyncConnectionClient client(grpc::CreateChannel(
+                        ip + ":" +
+                        std::to_string(config::IrohaConfigManager::getInstance()
+                                               .getGrpcPortNumber(50051)),
+                        grpc::InsecureChannelCredentials()));
+
+                return client.fetchStreamTransaction(ping);
+            }
+        }  // namespace fetchStreamTransaction
+
         namespace checkHash {
             bool send(const std::string &ip, const ::iroha::Ping &ping) {
                 logger::info("Connection with grpc") << "Send!";
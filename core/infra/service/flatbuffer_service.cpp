@@ -32,6 +32,7 @@
 #include <infra/config/peer_service_with_json.hpp>
 #include <membership_service/peer_service.hpp>
 #include <memory>
+#include <set>
 #include <string>
 #include <commands_generated.h>
 #include <endpoint_generated.h>
@@ -245,17 +246,25 @@ namespace flatbuffer_service {
     }
     if (tx.attachment() != nullptr) {
       assert(tx.attachment()->mime() != nullptr);
-      assert(tx.attachment()->data() != nullptr);
+      assert(tx.attachment()->data() != nullptr ||
+             tx.attachment()->digest() != nullptr);
 
       res += "attachment:[\n";
       res += " mime:" +
              std::string(tx.attachment()->mime()->begin(),
                          tx.attachment()->mime()->end()) +
              ",\n";
-      res += " data:" +
-             std::string(tx.attachment()->data()->begin(),
-                         tx.attachment()->data()->end()) +
-             ",\n";
+      if (tx.attachment()->data() != nullptr) {
+        res += " data:" +
+               std::string(tx.attachment()->data()->begin(),
+                           tx.attachment()->data()->end()) +
+               ",\n";
+      } else {
+        res += " digest:" +
+               std::string(tx.attachment()->digest()->begin(),
+                           tx.attachment()->digest()->end()) +
+               ",\n";
+      }
       res += "]\n";
     }
 
@@ -574,6 +583,14 @@ namespace flatbuffer_service {
         return makeUnexpected(handler.excptr());
       }
 
+      // data stored out of line is referred by digest only
+      const auto digest = fromTx.attachment()->digest();
+      if (digest != nullptr && fromTx.attachment()->data() == nullptr) {
+        std::vector<uint8_t> digestv(digest->begin(), digest->end());
+        return iroha::CreateAttachmentDirect(
+          fbb, fromTx.attachment()->mime()->c_str(), nullptr, &digestv);
+      }
+
       handler = ensureNotNull(fromTx.attachment()->data());
       if (!handler) {
         logger::error("Connection with grpc")
@@ -650,7 +667,8 @@ namespace flatbuffer_service {
       return makeUnexpected(txwrappers.excptr());
     }
     return ::iroha::CreateConsensusEventDirect(fbb, &peerSignatures.value(),
-                                               &txwrappers.value(), event.code());
+                                               &txwrappers.value(), event.code(),
+                                               event.order());
   }
 
   /**
@@ -677,12 +695,12 @@ namespace flatbuffer_service {
    * Argument fromTx will be deeply copied and create new consensus event that has
    * the copied transaction. - After creating new consensus event,
    * addSignature() is called from sumeragi. So, the new event has empty
-   * peerSignatures.
+   * peerSignatures. order is the sequence number given by leader.
    *
    * Returns: Expected<unique_ptr_t>
    */
   Expected<flatbuffers::unique_ptr_t> toConsensusEvent(
-    const iroha::Transaction& fromTx) {
+    const iroha::Transaction& fromTx, uint64_t order) {
     flatbuffers::FlatBufferBuilder fbb(16);
 
     std::vector<flatbuffers::Offset<::iroha::Signature>>
@@ -694,7 +712,7 @@ namespace flatbuffer_service {
     txs.push_back(*txwOffset);
 
     auto consensusEventOffset = ::iroha::CreateConsensusEventDirect(
-      fbb, &peerSignatureOffsets, &txs, ::iroha::Code::UNDECIDED);
+      fbb, &peerSignatureOffsets, &txs, ::iroha::Code::UNDECIDED, order);
     fbb.Finish(consensusEventOffset);
     return fbb.ReleaseBufferPointer();
   }
@@ -725,21 +743,72 @@ namespace flatbuffer_service {
       ::iroha::CreateSignatureDirect(fbb, publicKey.c_str(),
                                      &aNewPeerSigBlob, datetime::unixtime()));
 
-    // ToDo: #(tx) = 1
-    auto tx = std::vector<uint8_t>(event.transactions()->Get(0)->tx()->begin(),
-                                   event.transactions()->Get(0)->tx()->end());
+    // abort event has no transactions
+    auto txwrappers = detail::copyTxWrappersOfEvent(fbb, event);
+    if (!txwrappers) {
+      return makeUnexpected(txwrappers.excptr());
+    }
 
-    std::vector<flatbuffers::Offset<iroha::TransactionWrapper>> txwrappers;
-    txwrappers.push_back(
-      ::iroha::CreateTransactionWrapperDirect(fbb, &tx));
+    auto consensusEventOffset = ::iroha::CreateConsensusEventDirect(
+      fbb, &peerSignatures, &txwrappers.value(), event.code(), event.order());
+
+    fbb.Finish(consensusEventOffset);
+    return fbb.ReleaseBufferPointer();
+  }
+
+  Expected<flatbuffers::unique_ptr_t> mergeSignatures(
+    const iroha::ConsensusEvent& event, const iroha::ConsensusEvent& other) {
+    flatbuffers::FlatBufferBuilder fbb(16);
+
+    std::vector<flatbuffers::Offset<iroha::Signature>> peerSignatures;
+    std::set<std::string> publicKeys;
+
+    for (const auto* sigs : {event.peerSignatures(), other.peerSignatures()}) {
+      for (const auto& aPeerSig : *sigs) {
+        if (!publicKeys.insert(aPeerSig->publicKey()->str()).second) {
+          continue;
+        }
+        std::vector<uint8_t> aPeerSigBlob(aPeerSig->signature()->begin(),
+                                          aPeerSig->signature()->end());
+        peerSignatures.push_back(::iroha::CreateSignatureDirect(
+          fbb, aPeerSig->publicKey()->c_str(), &aPeerSigBlob,
+          aPeerSig->timestamp()));
+      }
+    }
+
+    auto txwrappers = detail::copyTxWrappersOfEvent(fbb, event);
+    if (!txwrappers) {
+      return makeUnexpected(txwrappers.excptr());
+    }
 
     auto consensusEventOffset = ::iroha::CreateConsensusEventDirect(
-      fbb, &peerSignatures, &txwrappers, event.code());
+      fbb, &peerSignatures, &txwrappers.value(), event.code(), event.order());
 
     fbb.Finish(consensusEventOffset);
     return fbb.ReleaseBufferPointer();
   }
 
+  /**
+   * makeAbort
+   * - Creates undecided event for order without transactions. Peers decide it
+   * instead of the event of the leader, which is never decided, so the order
+   * is applied as empty.
+   *
+   * Returns: Expected<unique_ptr_t>
+   */
+  Expected<flatbuffers::unique_ptr_t> makeAbort(uint64_t order) {
+    flatbuffers::FlatBufferBuilder fbb(16);
+
+    std::vector<flatbuffers::Offset<::iroha::Signature>>
+      peerSignatureOffsets;  // Empty.
+    std::vector<flatbuffers::Offset<::iroha::TransactionWrapper>> txs;
+
+    auto consensusEventOffset = ::iroha::CreateConsensusEventDirect(
+      fbb, &peerSignatureOffsets, &txs, ::iroha::Code::UNDECIDED, order);
+    fbb.Finish(consensusEventOffset);
+    return fbb.ReleaseBufferPointer();
+  }
+
   Expected<flatbuffers::unique_ptr_t> makeCommit(
     const iroha::ConsensusEvent& event) {
     flatbuffers::FlatBufferBuilder fbb(16);
@@ -761,7 +830,7 @@ namespace flatbuffer_service {
 
     auto consensusEventOffset = ::iroha::CreateConsensusEventDirect(
       fbb, &peerSignatures, &txwrappers.value(),
-      iroha::Code::COMMIT);
+      iroha::Code::COMMIT, event.order());
 
     fbb.Finish(consensusEventOffset);
     return fbb.ReleaseBufferPointer();
@@ -887,6 +956,45 @@ namespace flatbuffer_service {
       return nested;
     }
 
+    /**
+     * GetDetachedTxPointer(tx, digest)
+     * - copies transaction like GetTxPointer(), but attachment's data is
+     * replaced with its digest. Hash and signatures are copied as is, they
+     * are made over the original data.
+     */
+    Expected<std::vector<uint8_t>> GetDetachedTxPointer(
+      const iroha::Transaction &tx, const std::vector<uint8_t> &digest) {
+      flatbuffers::FlatBufferBuilder xbb;
+      auto tx_signatures = detail::copySignaturesOfTx(xbb, tx);
+      if (!tx_signatures) {
+        return makeUnexpected(tx_signatures.excptr());
+      }
+
+      auto hash = detail::copyHashOfTx(tx);
+      if (!hash) {
+        return makeUnexpected(hash.excptr());
+      }
+
+      VoidHandler handler;
+      handler = ensureNotNull(tx.attachment());
+      if (!handler) {
+        logger::error("Connection with grpc") << "Transaction attachment is null";
+        return makeUnexpected(handler.excptr());
+      }
+
+      const auto mime = tx.attachment()->mime();
+      auto attachment = iroha::CreateAttachmentDirect(
+        xbb, mime ? mime->c_str() : nullptr, nullptr, &digest);
+
+      const auto cmd = flatbuffer_service::CreateCommandFromTx(xbb, tx);
+      xbb.Finish(::iroha::CreateTransactionDirect(
+        xbb, tx.creatorPubKey()->c_str(), tx.command_type(), cmd,
+        &tx_signatures.value(), &hash.value(), tx.timestamp(), attachment));
+
+      auto ptr = xbb.GetBufferPointer();
+      return std::vector<uint8_t>(ptr, ptr + xbb.GetSize());
+    }
+
     std::vector<uint8_t> CreateTransaction(
       flatbuffers::FlatBufferBuilder& fbb,
       const std::string& creatorPubKey,
@@ -964,9 +1072,18 @@ namespace flatbuffer_service {
     std::vector<uint8_t> CreatePing(
         const std::string &message,
         const std::string &sender
+    ){
+      return CreatePing(message, sender, 0);
+    }
+
+    std::vector<uint8_t> CreatePing(
+        const std::string &message,
+        const std::string &sender,
+        uint64_t index,
+        uint64_t count
     ){
       flatbuffers::FlatBufferBuilder fbb;
-      auto ping = ::iroha::CreatePing(fbb, fbb.CreateString(message), fbb.CreateString(sender));
+      auto ping = ::iroha::CreatePing(fbb, fbb.CreateString(message), fbb.CreateString(sender), index, count);
       fbb.Finish(ping);
       return {fbb.GetBufferPointer(), fbb.GetBufferPointer()+fbb.GetSize()};
     }
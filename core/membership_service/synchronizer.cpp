@@ -27,9 +27,13 @@ limitations under the License.
 #include <infra/config/iroha_config_with_json.hpp>
 
 #include <utils/cache_map.hpp>
-#include <utils/timer.hpp>
 #include <ametsuchi/repository.hpp>
-#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 
 namespace peer{
@@ -44,6 +48,7 @@ namespace peer{
       auto vec = flatbuffer_service::endpoint::CreatePing(message,myip);
       auto &ping = *flatbuffers::GetRoot<iroha::Ping>(vec.data());
       connection::memberShipService::SyncImpl::getPeers::send(default_leader_ip,ping);
+      leader = ::peer::service::leader();
 
       checkRootHashStep();
     }
@@ -57,16 +62,88 @@ namespace peer{
       if( ::peer::myself::isActive() ) {
         ::peer::myself::stop();
         ::peer::transaction::isssue::setActive(leader->ip,::peer::myself::getIp(),false);
+        // empty ledger starts from leader's snapshot, only newer transactions are replayed
+        if( repository::getHeight() == 0 ) detail::bootstrapFromSnapshot();
+        // diverged ledger, which could not be replaced, stays stopped
+        if( seekStartFetchIndex() == 0 ) return;
+        detail::clearCache();
+        // transactions are streamed in background and applied as they come
+        std::thread fetcher(receiveTransactions);
         detail::appending();
+        detail::stopFetching();
+        fetcher.join();
       }
-      seekStartFetchIndex();
     }
 
-    void seekStartFetchIndex() { // step3 ( not support )
+    // Own ledger is either a prefix of the leader's one, then only the
+    // suffix is fetched, or it has a diverged tail. Committed WSV changes can
+    // not be undone, so the ledger is not truncated to the common prefix and
+    // the divergence point is not searched for: the diverged ledger is
+    // replaced by leader's snapshot and transactions after it are fetched.
+    size_t seekStartFetchIndex() { // step3
+      auto height = repository::getHeight();
+      auto first = detail::firstFetchIndex(height, detail::checkRootHashAt(height));
+      if( first == 0 ) {
+        if( !detail::bootstrapFromSnapshot() ) return 0;
+        first = repository::getHeight() + 1;
+      }
+      detail::current_ = first;
+      return first;
+    }
+
+    // receive count transactions from first, returns number of received ones
+    static size_t fetchRange(const std::string& ip, size_t first, size_t count) {
+      auto vec = flatbuffer_service::endpoint::CreatePing(
+          "fetch", ::peer::myself::getIp(), first, count);
+      auto &ping = *flatbuffers::GetRoot<::iroha::Ping>(vec.data());
+      return connection::memberShipService::SyncImpl::fetchStreamTransaction::send(ip, ping);
     }
 
+    // Missing range is split into chunks of SYNC_CHUNK_SIZE transactions,
+    // workers (one per up-to-date peer) take the next chunk until the end of
+    // the ledger is found. Chunks arrive out of order and are put in order by
+    // temp_tx_, every chunk is checked against leader's root when applied.
     void receiveTransactions() { // step4;
-      // TODO call fetchStreamTransaction()
+      std::string myip = ::peer::myself::getIp();
+      std::vector<std::string> ips;
+      for( auto &&p : ::peer::service::getActivePeerList() ) {
+        if( p->ip != myip && ips.size() < detail::SYNC_MAX_PEERS ) ips.push_back(p->ip);
+      }
+      if( ips.empty() ) ips.push_back(leader->ip);
+
+      std::mutex chunk_mutex;
+      size_t next = detail::current_;
+      size_t tail = std::numeric_limits<size_t>::max();
+      auto worker = [&](const std::string& ip) {
+        while( true ) {
+          size_t first;
+          {
+            std::lock_guard<std::mutex> lock(chunk_mutex);
+            if( next >= tail || detail::isFetchingStopped() ) return;
+            first = next;
+            next += detail::SYNC_CHUNK_SIZE;
+          }
+          auto received = fetchRange(ip, first, detail::SYNC_CHUNK_SIZE);
+          // peer is lagging or gone, the rest of the chunk is asked from leader
+          if( received < detail::SYNC_CHUNK_SIZE && ip != leader->ip ) {
+            received += fetchRange(leader->ip, first + received,
+                                   detail::SYNC_CHUNK_SIZE - received);
+          }
+          if( received < detail::SYNC_CHUNK_SIZE ) {
+            std::lock_guard<std::mutex> lock(chunk_mutex);
+            tail = std::min(tail, first + received);
+            return;
+          }
+        }
+      };
+
+      std::vector<std::thread> workers;
+      for( auto &&ip : ips ) workers.emplace_back(worker, ip);
+      for( auto &&w : workers ) w.join();
+
+      // transactions committed during download
+      if( !detail::isFetchingStopped() ) fetchRange(leader->ip, detail::nextMissing(), 0);
+      detail::finishFetching();
     }
 
     void peerActivateStep() { // step5;
@@ -77,9 +154,21 @@ namespace peer{
 
     namespace detail{
 
-      structure::CacheMap<size_t,const iroha::Transaction*> temp_tx_;
-      size_t current_;
-      time_t upd_time_;
+      // at most this many transactions are received ahead of current_, enough
+      // for every worker to have its chunk in flight
+      const size_t TEMP_TX_WINDOW = 2 * SYNC_MAX_PEERS * SYNC_CHUNK_SIZE;
+      // received transactions are filled by fetcher threads, guarded by temp_tx_mutex_.
+      // Everything pushed after an unapplied transaction lies within two windows
+      // of it, so with this capacity only applied ones are evicted as the oldest pushed.
+      structure::CacheMap<size_t,std::vector<uint8_t>> temp_tx_(2 * TEMP_TX_WINDOW);
+      std::mutex temp_tx_mutex_;
+      std::condition_variable temp_tx_cv_;
+      bool stop_fetching_ = false;
+      bool fetch_done_ = false;
+      size_t current_ = 1;
+      // index of the first requested transaction, chunks are counted from it
+      size_t fetch_base_ = 1;
+      std::chrono::steady_clock::time_point last_received_;
 
       // if roothash is trust roothash, return true. othrewise return false.
       bool checkRootHashAll(){
@@ -92,31 +181,116 @@ namespace peer{
           return true;
         return false;
       }
+      // Roots at a height commit to the whole prefix of the ledger, so own
+      // ledger is a prefix of the leader's one iff roots agree at own height.
+      size_t firstFetchIndex(size_t height, bool agrees){
+        if( height == 0 || agrees ) return height + 1;
+        return 0;
+      }
+      bool checkRootHashAt(size_t index){
+        std::string root_hash = repository::getMerkleRoot(index);
+        // heights below installed snapshot are trusted, snapshot root was checked
+        if( root_hash.empty() ) return true;
+        std::string myip = ::peer::myself::getPublicKey();
+
+        auto vec = flatbuffer_service::endpoint::CreatePing(root_hash,myip,index);
+        auto &ping = *flatbuffers::GetRoot<::iroha::Ping>(vec.data());
+        return connection::memberShipService::SyncImpl::checkHash::send(leader->ip, ping);
+      }
+      // compare own uncommitted root, after transaction index, with the leader's one
+      bool checkChunkRoot(size_t index){
+        std::string root_hash = repository::getMerkleRoot();
+        std::string myip = ::peer::myself::getPublicKey();
+
+        auto vec = flatbuffer_service::endpoint::CreatePing(root_hash,myip,index);
+        auto &ping = *flatbuffers::GetRoot<::iroha::Ping>(vec.data());
+        return connection::memberShipService::SyncImpl::checkHash::send(leader->ip, ping);
+      }
+      bool bootstrapFromSnapshot(){
+        std::string myip = ::peer::myself::getIp();
+        auto vec = flatbuffer_service::endpoint::CreatePing("snapshot",myip);
+        auto &ping = *flatbuffers::GetRoot<::iroha::Ping>(vec.data());
+        auto snapshot = connection::memberShipService::SyncImpl::fetchSnapshot::send(
+            leader->ip, ping, "/tmp/ametsuchi_snapshot_download/");
+        if( snapshot.folder.empty() ) return false;
+        return repository::installSnapshot(snapshot.folder, snapshot.root);
+      }
+      // tx points into a received buffer, so it is copied
+      // fetcher waits while it is too far ahead, returns false when fetching is stopped
       bool append_temporary(size_t tx_id,const iroha::Transaction* tx){
-        temp_tx_.set( tx_id, tx );
+        auto buf = flatbuffer_service::transaction::GetTxPointer(*tx);
+        if( !buf ) return false;
+        std::unique_lock<std::mutex> lock(temp_tx_mutex_);
+        temp_tx_cv_.wait(lock, [&]{
+          return stop_fetching_ || tx_id < current_ + TEMP_TX_WINDOW;
+        });
+        if( stop_fetching_ ) return false;
+        // already applied, e.g. sent by leader again
+        if( tx_id < current_ ) return true;
+        temp_tx_.set( tx_id, buf.value() );
+        last_received_ = std::chrono::steady_clock::now();
+        if( tx_id == current_ ) temp_tx_cv_.notify_all();
+        return true;
+      }
+      // transactions after the last verified chunk are dropped on error
+      static void dropUnverified(){
+        repository::rollback();
+        std::lock_guard<std::mutex> lock(temp_tx_mutex_);
+        current_ = repository::getHeight() + 1;
       }
       SYNCHRO_RESULT append(){
-        size_t old_current = current_;
+        std::unique_lock<std::mutex> lock(temp_tx_mutex_);
         while( temp_tx_.count(current_) ) {
-          auto &ap_tx = *temp_tx_[current_];
-          repository::append(ap_tx);
+          auto bytes = temp_tx_[current_];
+          lock.unlock();
+          repository::append(*flatbuffers::GetRoot<iroha::Transaction>(bytes.data()));
+          lock.lock();
           current_++;
+          temp_tx_cv_.notify_all();
+
+          // chunk is complete: keep it if leader has the same root, else drop it
+          if( (current_ - fetch_base_) % SYNC_CHUNK_SIZE == 0 ) {
+            lock.unlock();
+            if( !checkChunkRoot(current_ - 1) ) {
+              dropUnverified();
+              return SYNCHRO_RESULT::APPEND_ERROR;
+            }
+            repository::commit();
+            lock.lock();
+          }
         }
-        if( old_current != current_) {
-          if( checkRootHashAll() ) return SYNCHRO_RESULT::APPEND_FINISHED;
-        }
-        if( !temp_tx_.empty() ){ // if started downlaoding
-          // if elapsed that tiem is updated more than 2 sec and cache has more than index tx.
-          if( time(NULL) - upd_time_ > 2 && temp_tx_.getMaxKey() > current_ )
-            return SYNCHRO_RESULT::APPEND_ERROR;
+        // leader's ledger is received, it is finished if roots are the same
+        if( !fetch_done_ ) return SYNCHRO_RESULT::APPEND_ONGOING;
+        lock.unlock();
+        if( checkRootHashAll() ) {
+          repository::commit();
+          return SYNCHRO_RESULT::APPEND_FINISHED;
         }
-        return SYNCHRO_RESULT::APPEND_ONGOING;
+        dropUnverified();
+        return SYNCHRO_RESULT::APPEND_ERROR;
       }
+      // Transactions are applied as soon as the next one is received.
+      // Download is stalled if nothing is received for SYNC_STALL_TIMEOUT.
+      // cache is cleared by the caller, before transactions are requested
       void appending(){
-        clearCache();
-
+        {
+          std::lock_guard<std::mutex> lock(temp_tx_mutex_);
+          last_received_ = std::chrono::steady_clock::now();
+        }
         while( !::peer::myself::isActive() ) {
-          timer::waitTimer(1000);
+          {
+            std::unique_lock<std::mutex> lock(temp_tx_mutex_);
+            while( !temp_tx_.count(current_) && !fetch_done_ && !stop_fetching_ ) {
+              auto deadline = last_received_ + SYNC_STALL_TIMEOUT;
+              if( temp_tx_cv_.wait_until(lock, deadline) == std::cv_status::timeout &&
+                  std::chrono::steady_clock::now() >= last_received_ + SYNC_STALL_TIMEOUT ) {
+                lock.unlock();
+                dropUnverified();
+                checkRootHashAll();
+                return;
+              }
+            }
+          }
           switch( append() ) {
             case SYNCHRO_RESULT::APPEND_ERROR:
               checkRootHashAll();
@@ -130,10 +304,34 @@ namespace peer{
         }
 
       }
+      // current_ is kept, it is set by seekStartFetchIndex()
       void clearCache(){
-        current_ = 0;
+        std::lock_guard<std::mutex> lock(temp_tx_mutex_);
+        stop_fetching_ = false;
+        fetch_done_ = false;
+        fetch_base_ = current_;
         temp_tx_.clear();
       }
+      void stopFetching(){
+        std::lock_guard<std::mutex> lock(temp_tx_mutex_);
+        stop_fetching_ = true;
+        temp_tx_cv_.notify_all();
+      }
+      void finishFetching(){
+        std::lock_guard<std::mutex> lock(temp_tx_mutex_);
+        fetch_done_ = true;
+        temp_tx_cv_.notify_all();
+      }
+      bool isFetchingStopped(){
+        std::lock_guard<std::mutex> lock(temp_tx_mutex_);
+        return stop_fetching_;
+      }
+      size_t nextMissing(){
+        std::lock_guard<std::mutex> lock(temp_tx_mutex_);
+        size_t index = current_;
+        while( temp_tx_.count(index) ) index++;
+        return index;
+      }
     } // namespace datail
 
 
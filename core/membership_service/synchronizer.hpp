@@ -23,6 +23,7 @@ limitations under the License.
 
 #include <transaction_generated.h>
 #include <utils/cache_map.hpp>
+#include <chrono>
 #include <string>
 
 namespace peer{
@@ -32,7 +33,9 @@ namespace peer{
     void startSynchronizeLedger();
     void checkRootHashStep(); // step1
     void peerStopStep(); // step2
-    void seekStartFetchIndex(); // step3 ( not support )
+    // step3, returns the first index to fetch, 0 if own ledger diverged and
+    // could not be replaced by leader's snapshot
+    size_t seekStartFetchIndex();
     void receiveTransactions(); // step4;
     void peerActivateStep(); // step5;
 
@@ -43,13 +46,39 @@ namespace peer{
     };
 
     namespace detail{
+      // transactions per chunk of parallel download
+      const size_t SYNC_CHUNK_SIZE = 512;
+      // peers downloaded from at the same time
+      const size_t SYNC_MAX_PEERS = 4;
+      // download is stalled if nothing is received for this time
+      const std::chrono::milliseconds SYNC_STALL_TIMEOUT(5000);
+
       // if roothash is trust roothash, return true. othrewise return false.
       bool checkRootHashAll();
+      // compare own root at height index with the leader's one
+      bool checkRootHashAt(size_t index);
+      // first index to fetch after own ledger of height, or 0 if its tail
+      // diverged from the leader's ledger (roots do not agree at height) and
+      // the whole ledger has to be replaced
+      size_t firstFetchIndex(size_t height, bool agrees);
+      // compare own uncommitted root with the leader's one at height index
+      bool checkChunkRoot(size_t index);
+      extern size_t current_;
+
+      // download leader's WSV snapshot and install it, return true if its root is trusted
+      bool bootstrapFromSnapshot();
 
       bool append_temporary(size_t,const iroha::Transaction*);
       SYNCHRO_RESULT append();
       void appending();
       void clearCache();
+      // received transactions are rejected until next clearCache()
+      void stopFetching();
+      // all requested transactions are received
+      void finishFetching();
+      bool isFetchingStopped();
+      // first index after current_, which is not received yet
+      size_t nextMissing();
     } // namespace datail
 
   } // namespace sync
@@ -18,10 +18,12 @@ limitations under the License.
 #include <ametsuchi/repository.hpp>
 
 #include <infra/ametsuchi/include/ametsuchi/ametsuchi.h>
+#include <infra/ametsuchi/include/ametsuchi/exception.h>
+#include <utils/logger.hpp>
 
 namespace runtime{
 
-    void processTransaction(const iroha::Transaction& tx){
+    void processTransaction(const iroha::Transaction& tx, std::uint64_t order){
         if(!validator::account_exist_validator(*tx.creatorPubKey())){
             // Reject
             //return;
@@ -32,8 +34,28 @@ namespace runtime{
         if(!validator::logic_validator(tx)){
             // Reject
         }
-        repository::append(tx);
+        try {
+            repository::append(tx);
+        } catch (ametsuchi::exception::InvalidTransaction e) {
+            // every peer rejects it alike: the order is consumed without it
+            logger::warning("runtime") << "transaction of order " << order
+                                       << " is rejected, error "
+                                       << static_cast<int>(e);
+            repository::rollback();
+        } catch (...) {
+            // ledger fault: nothing of the order is kept, it is applied again
+            repository::rollback();
+            throw;
+        }
+        repository::setOrder(order);
+        // transaction is committed by consensus, it is served to syncing peers
+        repository::commit();
       std::cout << "APPENDED\n";
     }
 
+    void processEmpty(std::uint64_t order){
+        repository::setOrder(order);
+        repository::commit();
+    }
+
 };
\ No newline at end of file
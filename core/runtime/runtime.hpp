@@ -18,11 +18,18 @@ limitations under the License.
 #define IROHA_RUNTIME_HPP
 
 #include <main_generated.h>
+#include <cstdint>
 #include "command/add.hpp"
 
 namespace runtime{
 
-    void processTransaction(const iroha::Transaction& tx);
+    // apply transaction decided by consensus at order, the order is
+    // committed even if the transaction is rejected (InvalidTransaction)
+    void processTransaction(const iroha::Transaction& tx, std::uint64_t order);
+
+    // order is decided without a transaction: it is aborted, or its
+    // transaction is applied already
+    void processEmpty(std::uint64_t order);
 
 };
 
@@ -63,7 +63,10 @@ namespace iroha {
 namespace SumeragiImpl {
 namespace Torii {
 
-using CallBackFunc = std::function<void(
+// returns admission of the transaction: UNDECIDED - accepted, COMMIT - already
+// committed, BUSY - retry later, FAIL - rejected. from is ip of the peer,
+// which forwarded the transaction by Torii::send, empty if a client sent it
+using CallBackFunc = std::function<::iroha::Code(
     const std::string& /* from */, flatbuffers::unique_ptr_t&& /* message */)>;
 void receive(Torii::CallBackFunc&& callback);
 /*
@@ -92,6 +95,18 @@ using CallBackFunc = std::function<std::vector<const ::iroha::Asset*>(
 
 void receive(AccountGetAsset::CallBackFunc&& callback);
 }
+namespace AssetGetStats {
+struct Stats {
+  std::string total_supply;
+  uint64_t holders;
+  uint8_t precision;
+};
+
+using CallBackFunc = std::function<Stats(
+    const std::string& /* from */, flatbuffers::unique_ptr_t&& /* message */)>;
+
+void receive(AssetGetStats::CallBackFunc&& callback);
+}
 }
 }  // namespace iroha::AssetRepositoryImpl
 
@@ -121,12 +136,34 @@ namespace getPeers {
 bool send(const std::string& ip, const ::iroha::Ping& ping);
 }  // namespace getPeers
 namespace getTransactions {
-using CallBackFunc = std::function<std::vector<const ::iroha::Transaction*>(
+using CallBackFunc = std::function<std::vector<std::shared_ptr<const ::iroha::Transaction>>(
         const std::string& /* from */, flatbuffers::unique_ptr_t&& /* message */)>;
 
 void receive(getTransactions::CallBackFunc&& callback);
 bool send(const std::string& ip, const ::iroha::Ping& ping);
 }  // namespace getPeers
+namespace fetchStreamTransaction {
+// Receive committed transactions from ping.index up to the peer's height,
+// they are passed to peer::sync::detail::append_temporary().
+// Returns number of received transactions.
+size_t send(const std::string& ip, const ::iroha::Ping& ping);
+}  // namespace fetchStreamTransaction
+namespace fetchSnapshot {
+struct Snapshot {
+  std::string folder;  // empty if there is no snapshot
+  uint64_t height;
+  std::string root;
+};
+
+using CallBackFunc = std::function<Snapshot(
+    const std::string& /* from */, flatbuffers::unique_ptr_t&& /* message */)>;
+
+void receive(fetchSnapshot::CallBackFunc&& callback);
+// Download snapshot of the peer into folder, folder of result is empty on
+// failure
+Snapshot send(const std::string& ip, const ::iroha::Ping& ping,
+              const std::string& folder);
+}  // namespace fetchSnapshot
 }  // namespace SyncImpl
 }  // namespace memberShipService
 
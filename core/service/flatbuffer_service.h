@@ -88,11 +88,18 @@ namespace flatbuffer_service {
     const iroha::ConsensusEvent &event, const std::string &publicKey,
     const std::string &signature);
 
+  // copy of event with signatures of both events, one per public key
+  Expected<flatbuffers::unique_ptr_t> mergeSignatures(
+    const iroha::ConsensusEvent &event, const iroha::ConsensusEvent &other);
+
   Expected<flatbuffers::Offset<::iroha::TransactionWrapper>> toTxWrapper(
     flatbuffers::FlatBufferBuilder &, const ::iroha::Transaction &);
 
   Expected<flatbuffers::unique_ptr_t> toConsensusEvent(
-    const iroha::Transaction &tx);
+    const iroha::Transaction &tx, uint64_t order = 0);
+
+  // event without transactions: order is decided, but nothing is applied
+  Expected<flatbuffers::unique_ptr_t> makeAbort(uint64_t order);
 
   Expected<flatbuffers::unique_ptr_t> makeCommit(
     const iroha::ConsensusEvent &event);
@@ -157,6 +164,10 @@ namespace flatbuffer_service {
 
     Expected<std::vector<uint8_t>> GetTxPointer(const iroha::Transaction &tx);
 
+    // Copy of the transaction, which refers to attachment's data by digest
+    Expected<std::vector<uint8_t>> GetDetachedTxPointer(
+      const iroha::Transaction &tx, const std::vector<uint8_t> &digest);
+
     std::vector<uint8_t> CreateTransaction(
       flatbuffers::FlatBufferBuilder& fbb,
       const std::string& creatorPubKey,
@@ -178,6 +189,13 @@ namespace flatbuffer_service {
         const std::string &message,
         const std::string &sender
     );
+
+    std::vector<uint8_t> CreatePing(
+        const std::string &message,
+        const std::string &sender,
+        uint64_t index,
+        uint64_t count = 0
+    );
   }
 };      // namespace flatbuffer_service
 #endif  // IROHA_FLATBUFFER_SERVICE_H
@@ -47,7 +47,7 @@ class CacheMap {
   // erase last push node
   size_t erase_one() {
     if (data_.empty()) return data_.size();
-    Key& k = cache_.front();
+    Key k = cache_.front();
     cache_.pop_front();
     if (max_cache_.front() == k) max_cache_.pop_front();
     data_.erase(k);
@@ -90,6 +90,8 @@ class CacheMap {
     while (!max_cache_.empty() && max_cache_.back() < k) max_cache_.pop_back();
     max_cache_.push_back(k);
     data_[k] = v;
+    while (data_.size() > max_cache_size_) erase_one();
+    return data_.size();
   }
 
   // [] oprator
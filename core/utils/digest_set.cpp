@@ -0,0 +1,132 @@
+/*
+Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "digest_set.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace structure {
+
+// keys are hashes already, their bytes are used as is
+static std::uint64_t word(const DigestSet::Key &key, size_t offset) {
+  std::uint64_t w = 0;
+  for (size_t i = 0; i < sizeof(w); i++) {
+    w = (w << 8) | key[offset + i];
+  }
+  return w;
+}
+
+DigestSet::DigestSet(size_t capacity, size_t shards) {
+  shards = std::max<size_t>(shards, 1);
+  epoch_size_ = std::max<size_t>((capacity + shards - 1) / shards, 1);
+
+  // two epochs take at most half of the slots, so probes stay short
+  size_t slots = 1;
+  while (slots < 4 * epoch_size_) slots <<= 1;
+  mask_ = slots - 1;
+
+  for (size_t i = 0; i < shards; i++) {
+    shards_.emplace_back(new Shard());
+    shards_.back()->slots.resize(slots, Slot{Key{}, 0});
+  }
+}
+
+DigestSet::Shard &DigestSet::shard(const Key &key) const {
+  return *shards_[word(key, 0) % shards_.size()];
+}
+
+size_t DigestSet::slot(const Key &key) const {
+  return static_cast<size_t>(word(key, 8)) & mask_;
+}
+
+bool DigestSet::insert(const Key &key) {
+  auto &s = shard(key);
+  std::lock_guard<std::mutex> lock(s.mutex);
+
+  auto i = slot(key);
+  while (s.slots[i].epoch != 0) {
+    if (s.slots[i].key == key) return false;
+    i = (i + 1) & mask_;
+  }
+
+  if (s.inserted == epoch_size_) {
+    advance(s);
+    i = slot(key);
+    while (s.slots[i].epoch != 0) i = (i + 1) & mask_;
+  }
+  s.slots[i] = Slot{key, s.epoch};
+  s.inserted++;
+  s.size++;
+  return true;
+}
+
+bool DigestSet::contains(const Key &key) const {
+  auto &s = shard(key);
+  std::lock_guard<std::mutex> lock(s.mutex);
+
+  auto i = slot(key);
+  while (s.slots[i].epoch != 0) {
+    if (s.slots[i].key == key) return true;
+    i = (i + 1) & mask_;
+  }
+  return false;
+}
+
+size_t DigestSet::size() const {
+  size_t size = 0;
+  for (auto &&s : shards_) {
+    std::lock_guard<std::mutex> lock(s->mutex);
+    size += s->size;
+  }
+  return size;
+}
+
+void DigestSet::advance(Shard &s) {
+  // Removing a key would break probe sequences of the keys after it, so the
+  // shard is rebuilt from the keys, which are kept. That is once per
+  // epoch_size_ inserts, amortized O(1).
+  std::vector<Slot> slots(s.slots.size(), Slot{Key{}, 0});
+  s.size = 0;
+  for (auto &&old : s.slots) {
+    if (old.epoch != s.epoch) continue;
+    auto i = slot(old.key);
+    while (slots[i].epoch != 0) i = (i + 1) & mask_;
+    slots[i] = old;
+    s.size++;
+  }
+  s.slots.swap(slots);
+  s.epoch++;
+  s.inserted = 0;
+}
+
+DigestSet::Key DigestSet::fromHex(const std::string &hex) {
+  Key key;
+  if (hex.size() != 2 * key.size()) {
+    throw std::invalid_argument("digest must be 64 hex digits");
+  }
+  auto digit = [](char c) -> std::uint8_t {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    throw std::invalid_argument("digest must be 64 hex digits");
+  };
+  for (size_t i = 0; i < key.size(); i++) {
+    key[i] = (digit(hex[2 * i]) << 4) | digit(hex[2 * i + 1]);
+  }
+  return key;
+}
+
+}  // namespace structure
@@ -0,0 +1,80 @@
+/*
+Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef IROHA_DIGEST_SET_HPP
+#define IROHA_DIGEST_SET_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace structure {
+
+/*
+ * DigestSet is a fixed-capacity concurrent set of 32-byte hashes.
+ * Keys are spread over shards, every shard is an open-addressing table
+ * guarded by its own mutex and never grows.
+ * Keys are inserted in epochs: when a shard has taken capacity / shards keys
+ * in the current epoch, a new epoch starts and keys older than the previous
+ * epoch are forgotten. So the set remembers at least the last
+ * capacity / shards keys of every shard, and holds at most twice as many.
+ */
+class DigestSet {
+ public:
+  using Key = std::array<std::uint8_t, 32>;
+
+  explicit DigestSet(size_t capacity = 65536, size_t shards = 16);
+
+  // Returns true if the key was not in the set (and is inserted now)
+  bool insert(const Key& key);
+
+  bool contains(const Key& key) const;
+
+  size_t size() const;
+
+  // Decodes sha3_256_hex() output, throws std::invalid_argument otherwise
+  static Key fromHex(const std::string& hex);
+
+ private:
+  struct Slot {
+    Key key;
+    std::uint32_t epoch;  // 0 - empty
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::vector<Slot> slots;
+    std::uint32_t epoch = 1;
+    size_t inserted = 0;  // keys inserted in the current epoch
+    size_t size = 0;
+  };
+
+  size_t epoch_size_;
+  size_t mask_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  Shard& shard(const Key& key) const;
+  size_t slot(const Key& key) const;
+  // start a new epoch, keep and rehash only keys of the previous one
+  void advance(Shard& shard);
+};
+
+}  // namespace structure
+
+#endif  // IROHA_DIGEST_SET_HPP
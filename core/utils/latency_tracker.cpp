@@ -0,0 +1,72 @@
+/*
+Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "latency_tracker.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace timer {
+
+// nearest-rank percentile, samples are reordered
+static LatencyTracker::duration nearest_rank(
+    std::vector<LatencyTracker::duration::rep> &samples, double p) {
+  if (samples.empty()) return LatencyTracker::duration::zero();
+  p = std::min(std::max(p, 0.0), 100.0);
+  size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+  size_t k = rank == 0 ? 0 : rank - 1;
+  std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+  return LatencyTracker::duration(samples[k]);
+}
+
+void LatencyTracker::record(const std::string &key, duration sample) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &samples = samples_[key];
+  samples.push_back(sample.count());
+  if (samples.size() > window_) samples.pop_front();
+}
+
+LatencyTracker::duration LatencyTracker::percentile(const std::string &key,
+                                                    double p) const {
+  std::vector<duration::rep> samples;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = samples_.find(key);
+    if (it != samples_.end()) {
+      samples.assign(it->second.begin(), it->second.end());
+    }
+  }
+  return nearest_rank(samples, p);
+}
+
+LatencyTracker::duration LatencyTracker::percentile(double p) const {
+  std::vector<duration::rep> samples;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &&e : samples_) {
+      samples.insert(samples.end(), e.second.begin(), e.second.end());
+    }
+  }
+  return nearest_rank(samples, p);
+}
+
+size_t LatencyTracker::count(const std::string &key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = samples_.find(key);
+  return it == samples_.end() ? 0 : it->second.size();
+}
+
+}  // namespace timer
@@ -0,0 +1,57 @@
+/*
+Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef IROHA_LATENCY_TRACKER_HPP
+#define IROHA_LATENCY_TRACKER_HPP
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace timer {
+
+/*
+ * LatencyTracker keeps the latest samples of every key (e.g. peer's ip) and
+ * answers percentiles over them, so timeouts may follow the network.
+ * Only the last window samples of a key are kept.
+ */
+class LatencyTracker {
+ public:
+  using duration = std::chrono::microseconds;
+
+  explicit LatencyTracker(size_t window = 256) : window_(window) {}
+
+  void record(const std::string& key, duration sample);
+
+  // p-th percentile (0 - 100) of key's samples, zero if there are none
+  duration percentile(const std::string& key, double p) const;
+
+  // p-th percentile of samples of every key
+  duration percentile(double p) const;
+
+  size_t count(const std::string& key) const;
+
+ private:
+  size_t window_;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::deque<duration::rep>> samples_;
+};
+
+}  // namespace timer
+
+#endif  // IROHA_LATENCY_TRACKER_HPP
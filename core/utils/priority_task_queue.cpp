@@ -0,0 +1,53 @@
+/*
+Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "priority_task_queue.hpp"
+#include <algorithm>
+
+namespace structure {
+
+PriorityTaskQueue::PriorityTaskQueue(size_t levels)
+    : levels_(std::max<size_t>(levels, 1)) {}
+
+void PriorityTaskQueue::push(size_t level, std::function<void(void)> task) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  levels_[std::min(level, levels_.size() - 1)].push_back(std::move(task));
+}
+
+bool PriorityTaskQueue::run_one() {
+  std::function<void(void)> task;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &&level : levels_) {
+      if (!level.empty()) {
+        task = std::move(level.front());
+        level.pop_front();
+        break;
+      }
+    }
+  }
+  if (!task) return false;
+  // outside of the lock, the task may push new tasks
+  task();
+  return true;
+}
+
+size_t PriorityTaskQueue::size(size_t level) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return level < levels_.size() ? levels_[level].size() : 0;
+}
+
+}  // namespace structure
@@ -0,0 +1,55 @@
+/*
+Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef IROHA_PRIORITY_TASK_QUEUE_HPP
+#define IROHA_PRIORITY_TASK_QUEUE_HPP
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace structure {
+
+/*
+ * PriorityTaskQueue keeps tasks in levels, level 0 is the most urgent.
+ * It does not run threads, it is put in front of a thread pool: every
+ * push() is followed by one pool task calling run_one(), which runs the most
+ * urgent task queued at that moment, not the pushed one. So an urgent task
+ * overtakes every less urgent one, which is waiting in the pool's queue.
+ * Tasks of one level run in FIFO order.
+ */
+class PriorityTaskQueue {
+ public:
+  explicit PriorityTaskQueue(size_t levels);
+
+  // level is clamped to the least urgent one
+  void push(size_t level, std::function<void(void)> task);
+
+  // run the most urgent task, returns false if there are none
+  bool run_one();
+
+  // number of tasks queued in level
+  size_t size(size_t level) const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::deque<std::function<void(void)>>> levels_;
+};
+
+}  // namespace structure
+
+#endif  // IROHA_PRIORITY_TASK_QUEUE_HPP
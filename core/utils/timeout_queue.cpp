@@ -0,0 +1,87 @@
+/*
+Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "timeout_queue.hpp"
+
+namespace timer {
+
+TimeoutQueue::TimeoutQueue() : thread_([this] { run(); }) {}
+
+TimeoutQueue::~TimeoutQueue() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+void TimeoutQueue::set(const std::string &key,
+                       std::chrono::milliseconds timeout,
+                       std::function<void(void)> action) {
+  auto deadline = clock::now() + timeout;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      deadlines_.erase({it->second.deadline, key});
+    }
+    entries_[key] = Entry{deadline, std::move(action)};
+    deadlines_.emplace(deadline, key);
+  }
+  cv_.notify_all();
+}
+
+bool TimeoutQueue::cancel(const std::string &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) return false;
+  deadlines_.erase({it->second.deadline, key});
+  entries_.erase(it);
+  return true;
+}
+
+size_t TimeoutQueue::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void TimeoutQueue::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    if (deadlines_.empty()) {
+      cv_.wait(lock);
+      continue;
+    }
+    auto earliest = *deadlines_.begin();
+    if (clock::now() < earliest.first) {
+      // woken up earlier by set(), cancel() or destructor
+      cv_.wait_until(lock, earliest.first);
+      continue;
+    }
+
+    deadlines_.erase(deadlines_.begin());
+    auto it = entries_.find(earliest.second);
+    auto action = std::move(it->second.action);
+    entries_.erase(it);
+
+    lock.unlock();
+    action();
+    lock.lock();
+  }
+}
+
+}  // namespace timer
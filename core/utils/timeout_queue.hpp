@@ -0,0 +1,78 @@
+/*
+Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef IROHA_TIMEOUT_QUEUE_HPP
+#define IROHA_TIMEOUT_QUEUE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace timer {
+
+/*
+ * TimeoutQueue runs actions after their timeouts on a single timer thread,
+ * callers are not blocked.
+ * Every timeout has a key (e.g. hash of consensus event), timeout set again
+ * with the same key replaces the previous one, cancel() removes it.
+ * Actions run outside of the lock, so they may set or cancel timeouts.
+ */
+class TimeoutQueue {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  TimeoutQueue();
+  ~TimeoutQueue();
+
+  TimeoutQueue(const TimeoutQueue&) = delete;
+  TimeoutQueue& operator=(const TimeoutQueue&) = delete;
+
+  // run action after timeout, unless it is cancelled
+  void set(const std::string& key, std::chrono::milliseconds timeout,
+           std::function<void(void)> action);
+
+  // returns false if there is no such timeout (fired or never set)
+  bool cancel(const std::string& key);
+
+  // number of pending timeouts
+  size_t size() const;
+
+ private:
+  struct Entry {
+    clock::time_point deadline;
+    std::function<void(void)> action;
+  };
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+  std::unordered_map<std::string, Entry> entries_;
+  // (deadline, key) of every entry, the earliest first
+  std::set<std::pair<clock::time_point, std::string>> deadlines_;
+  std::thread thread_;
+
+  void run();
+};
+
+}  // namespace timer
+
+#endif  // IROHA_TIMEOUT_QUEUE_HPP
@@ -20,6 +20,7 @@
 #include <endpoint_generated.h>
 #include <ametsuchi/exception.h>
 #include "../generator/tx_generator.h"
+#include <cstring>
 
 class Ametsuchi_Test : public ::testing::Test {
  protected:
@@ -236,6 +237,601 @@ TEST_F(Ametsuchi_Test, AssetTest) {
   }
 }
 
+TEST_F(Ametsuchi_Test, BalanceCacheRollbackTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+
+  auto blob = generator::random_transaction(
+      fbb, iroha::Command::AssetCreate,
+      generator::random_AssetCreate(fbb, "Dollar", "USA", "l1").Union());
+  ametsuchi_.append(&blob);
+
+  blob = generator::random_transaction(
+      fbb, iroha::Command::AccountAdd,
+      generator::random_AccountAdd(fbb, generator::random_account("1"))
+          .Union());
+  ametsuchi_.append(&blob);
+
+  auto add = [&fbb, this](uint64_t amount) {
+    auto blob = generator::random_transaction(
+        fbb, iroha::Command::Add,
+        generator::random_Add(fbb, "1",
+                              generator::random_asset_wrapper_currency(
+                                  amount, 2, "Dollar", "USA", "l1"))
+            .Union());
+    ametsuchi_.append(&blob);
+  };
+
+  flatbuffers::FlatBufferBuilder fbb2(2048);
+  auto reference_tx =
+      flatbuffers::GetRoot<iroha::Transaction>(
+          generator::random_transaction(
+              fbb2, iroha::Command::Add,
+              generator::random_Add(fbb2, "1",
+                                    generator::random_asset_wrapper_currency(
+                                        1, 2, "Dollar", "USA", "l1"))
+                  .Union())
+              .data())
+          ->command_as_Add();
+  auto currency = reference_tx->asset_nested_root()->asset_as_Currency();
+  auto amount = [&](bool uncommitted) {
+    return ametsuchi_
+        .accountGetAsset(reference_tx->accPubKey(), currency->ledger_name(),
+                         currency->domain_name(), currency->currency_name(),
+                         uncommitted)
+        ->asset_as_Currency()
+        ->amount()
+        ->str();
+  };
+
+  // several changes of the same balance are written once on commit
+  add(300);
+  add(45);
+  ametsuchi_.commit();
+  ASSERT_EQ(amount(false), "345");
+
+  // cached change is dropped by rollback, as well as its merkle leaf
+  auto root = ametsuchi_.getMerkleRoot();
+  add(100);
+  ASSERT_NE(ametsuchi_.getMerkleRoot(), root);
+  ametsuchi_.rollback();
+  ASSERT_EQ(amount(true), "345");
+  ASSERT_EQ(amount(false), "345");
+  ASSERT_EQ(ametsuchi_.getMerkleRoot(), root);
+}
+
+TEST_F(Ametsuchi_Test, NotFoundTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+
+  auto blob = generator::random_transaction(
+      fbb, iroha::Command::AssetCreate,
+      generator::random_AssetCreate(fbb, "Dollar", "USA", "l1").Union());
+  ametsuchi_.append(&blob);
+
+  blob = generator::random_transaction(
+      fbb, iroha::Command::AccountAdd,
+      generator::random_AccountAdd(fbb, generator::random_account("1"))
+          .Union());
+  ametsuchi_.append(&blob);
+  ametsuchi_.commit();
+
+  flatbuffers::FlatBufferBuilder fbb2(2048);
+  auto reference_tx =
+      flatbuffers::GetRoot<iroha::Transaction>(
+          generator::random_transaction(
+              fbb2, iroha::Command::Add,
+              generator::random_Add(fbb2, "1",
+                                    generator::random_asset_wrapper_currency(
+                                        1, 2, "Dollar", "USA", "l1"))
+                  .Union())
+              .data())
+          ->command_as_Add();
+  auto currency = reference_tx->asset_nested_root()->asset_as_Currency();
+
+  // account exists, but has no dollars yet
+  for (auto uncommitted : {true, false}) {
+    ASSERT_EQ(ametsuchi_.accountGetAsset(
+                  reference_tx->accPubKey(), currency->ledger_name(),
+                  currency->domain_name(), currency->currency_name(),
+                  uncommitted),
+              nullptr);
+    ASSERT_TRUE(
+        ametsuchi_.accountGetAllAssets(reference_tx->accPubKey(), uncommitted)
+            .empty());
+  }
+
+  // subtract from empty account is still an invalid transaction
+  blob = generator::random_transaction(
+      fbb, iroha::Command::Subtract,
+      generator::random_Subtract(fbb, "1",
+                                 generator::random_asset_wrapper_currency(
+                                     1, 2, "Dollar", "USA", "l1"))
+          .Union());
+  ASSERT_THROW(ametsuchi_.append(&blob),
+               ametsuchi::exception::InvalidTransaction);
+}
+
+TEST_F(Ametsuchi_Test, AccountHistoryTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+
+  auto blob = generator::random_transaction(
+      fbb, iroha::Command::AssetCreate,
+      generator::random_AssetCreate(fbb, "Dollar", "USA", "l1").Union());
+  ametsuchi_.append(&blob);
+
+  for (auto account : {"1", "2"}) {
+    blob = generator::random_transaction(
+        fbb, iroha::Command::AccountAdd,
+        generator::random_AccountAdd(fbb, generator::random_account(account))
+            .Union());
+    ametsuchi_.append(&blob);
+  }
+
+  blob = generator::random_transaction(
+      fbb, iroha::Command::Add,
+      generator::random_Add(fbb, "1",
+                            generator::random_asset_wrapper_currency(
+                                345, 2, "Dollar", "USA", "l1"))
+          .Union());
+  ametsuchi_.append(&blob);
+
+  blob = generator::random_transaction(
+      fbb, iroha::Command::Transfer,
+      generator::random_Transfer(fbb,
+                                 generator::random_asset_wrapper_currency(
+                                     100, 2, "Dollar", "USA", "l1"),
+                                 "1", "2")
+          .Union());
+  ametsuchi_.append(&blob);
+
+  flatbuffers::FlatBufferBuilder fbb2(256);
+  fbb2.Finish(fbb2.CreateString("1"));
+  auto pubkey = flatbuffers::GetRoot<flatbuffers::String>(fbb2.GetBufferPointer());
+
+  auto check = [&](bool uncommitted) {
+    auto history = ametsuchi_.getAccountHistory(pubkey, uncommitted);
+    ASSERT_EQ(history.size(), 3);
+    std::vector<iroha::Command> expected{iroha::Command::AccountAdd,
+                                         iroha::Command::Add,
+                                         iroha::Command::Transfer};
+    for (size_t i = 0; i < history.size(); i++) {
+      ASSERT_EQ(history[i].command, expected[i]);
+      auto tx = flatbuffers::GetRoot<iroha::Transaction>(history[i].tx.data);
+      ASSERT_EQ(tx->command_type(), expected[i]);
+      if (i > 0) ASSERT_LT(history[i - 1].index, history[i].index);
+    }
+  };
+
+  check(true);
+  ametsuchi_.commit();
+  check(false);
+}
+
+TEST_F(Ametsuchi_Test, TimestampIndexTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+
+  auto blob = generator::random_transaction(
+      fbb, iroha::Command::AssetCreate,
+      generator::random_AssetCreate(fbb, "Dollar", "USA", "l1").Union(), 5,
+      generator::random_public_key(), generator::random_blob(32), 100);
+  ametsuchi_.append(&blob);
+
+  blob = generator::random_transaction(
+      fbb, iroha::Command::AccountAdd,
+      generator::random_AccountAdd(fbb, generator::random_account("1"))
+          .Union(),
+      5, generator::random_public_key(), generator::random_blob(32), 200);
+  ametsuchi_.append(&blob);
+
+  // two transactions with the same timestamp
+  for (auto amount : {100, 200}) {
+    blob = generator::random_transaction(
+        fbb, iroha::Command::Add,
+        generator::random_Add(fbb, "1",
+                              generator::random_asset_wrapper_currency(
+                                  amount, 2, "Dollar", "USA", "l1"))
+            .Union(),
+        5, generator::random_public_key(), generator::random_blob(32), 300);
+    ametsuchi_.append(&blob);
+  }
+
+  flatbuffers::FlatBufferBuilder fbb2(256);
+  fbb2.Finish(fbb2.CreateString("1"));
+  auto pubkey =
+      flatbuffers::GetRoot<flatbuffers::String>(fbb2.GetBufferPointer());
+
+  auto check = [&](bool uncommitted) {
+    auto txs = ametsuchi_.getTransactionsByTime(150, 300, uncommitted);
+    ASSERT_EQ(txs.size(), 3);
+    std::vector<uint64_t> timestamps;
+    for (auto &&tx : txs) {
+      timestamps.push_back(
+          flatbuffers::GetRoot<iroha::Transaction>(tx.data)->timestamp());
+    }
+    ASSERT_EQ(timestamps, (std::vector<uint64_t>{200, 300, 300}));
+
+    ASSERT_TRUE(ametsuchi_.getTransactionsByTime(301, 1000, uncommitted)
+                    .empty());
+
+    // combined with account history
+    auto history = ametsuchi_.getAccountHistory(pubkey, 250, 300, uncommitted);
+    ASSERT_EQ(history.size(), 2);
+    ASSERT_EQ(history[0].command, iroha::Command::Add);
+    ASSERT_EQ(history[1].command, iroha::Command::Add);
+  };
+
+  check(true);
+  ametsuchi_.commit();
+  check(false);
+}
+
+TEST_F(Ametsuchi_Test, AssetStatsTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+
+  auto check = [&](int64_t supply, uint64_t holders, bool uncommitted) {
+    auto stats = ametsuchi_.assetGetStats("l1", "USA", "Dollar", uncommitted);
+    ASSERT_EQ(static_cast<int64_t>(stats.total_supply), supply);
+    ASSERT_EQ(stats.holders, holders);
+  };
+
+  // asset is not created
+  check(0, 0, true);
+
+  auto blob = generator::random_transaction(
+      fbb, iroha::Command::AssetCreate,
+      generator::random_AssetCreate(fbb, "Dollar", "USA", "l1").Union());
+  ametsuchi_.append(&blob);
+  check(0, 0, true);
+
+  for (auto account : {"1", "2"}) {
+    blob = generator::random_transaction(
+        fbb, iroha::Command::AccountAdd,
+        generator::random_AccountAdd(fbb, generator::random_account(account))
+            .Union());
+    ametsuchi_.append(&blob);
+  }
+
+  blob = generator::random_transaction(
+      fbb, iroha::Command::Add,
+      generator::random_Add(fbb, "1",
+                            generator::random_asset_wrapper_currency(
+                                345, 2, "Dollar", "USA", "l1"))
+          .Union());
+  ametsuchi_.append(&blob);
+  check(345, 1, true);
+
+  blob = generator::random_transaction(
+      fbb, iroha::Command::Transfer,
+      generator::random_Transfer(fbb,
+                                 generator::random_asset_wrapper_currency(
+                                     100, 2, "Dollar", "USA", "l1"),
+                                 "1", "2")
+          .Union());
+  ametsuchi_.append(&blob);
+  check(345, 2, true);
+  ametsuchi_.commit();
+  check(345, 2, false);
+
+  // account without balance is not a holder
+  blob = generator::random_transaction(
+      fbb, iroha::Command::Subtract,
+      generator::random_Subtract(fbb, "1",
+                                 generator::random_asset_wrapper_currency(
+                                     245, 2, "Dollar", "USA", "l1"))
+          .Union());
+  ametsuchi_.append(&blob);
+  check(100, 1, true);
+  check(345, 2, false);
+
+  ametsuchi_.rollback();
+  check(345, 2, true);
+}
+
+TEST_F(Ametsuchi_Test, BalanceAtHeightTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+
+  // height 1
+  auto blob = generator::random_transaction(
+      fbb, iroha::Command::AssetCreate,
+      generator::random_AssetCreate(fbb, "Dollar", "USA", "l1").Union());
+  ametsuchi_.append(&blob);
+
+  // height 2, 3
+  for (auto account : {"1", "2"}) {
+    blob = generator::random_transaction(
+        fbb, iroha::Command::AccountAdd,
+        generator::random_AccountAdd(fbb, generator::random_account(account))
+            .Union());
+    ametsuchi_.append(&blob);
+  }
+
+  // height 4
+  blob = generator::random_transaction(
+      fbb, iroha::Command::Add,
+      generator::random_Add(fbb, "1",
+                            generator::random_asset_wrapper_currency(
+                                345, 2, "Dollar", "USA", "l1"))
+          .Union());
+  ametsuchi_.append(&blob);
+  ametsuchi_.commit();
+
+  // height 5
+  blob = generator::random_transaction(
+      fbb, iroha::Command::Transfer,
+      generator::random_Transfer(fbb,
+                                 generator::random_asset_wrapper_currency(
+                                     100, 2, "Dollar", "USA", "l1"),
+                                 "1", "2")
+          .Union());
+  ametsuchi_.append(&blob);
+
+  flatbuffers::FlatBufferBuilder fbb2(2048);
+  auto reference_tx =
+      flatbuffers::GetRoot<iroha::Transaction>(
+          generator::random_transaction(
+              fbb2, iroha::Command::Add,
+              generator::random_Add(fbb2, "1",
+                                    generator::random_asset_wrapper_currency(
+                                        1, 2, "Dollar", "USA", "l1"))
+                  .Union())
+              .data())
+          ->command_as_Add();
+  auto currency = reference_tx->asset_nested_root()->asset_as_Currency();
+
+  auto amount_at = [&](size_t height, bool uncommitted) -> std::string {
+    auto asset = ametsuchi_.accountGetAssetAt(
+        reference_tx->accPubKey(), currency->ledger_name(),
+        currency->domain_name(), currency->currency_name(), height,
+        uncommitted);
+    return asset == nullptr ? "none"
+                            : asset->asset_as_Currency()->amount()->str();
+  };
+
+  ASSERT_EQ(amount_at(3, true), "none");
+  ASSERT_EQ(amount_at(4, true), "345");
+  ASSERT_EQ(amount_at(5, true), "245");
+  ASSERT_EQ(amount_at(100, true), "245");
+
+  // transfer is not committed yet
+  ASSERT_EQ(amount_at(3, false), "none");
+  ASSERT_EQ(amount_at(5, false), "345");
+
+  ametsuchi_.commit();
+  ASSERT_EQ(amount_at(4, false), "345");
+  ASSERT_EQ(amount_at(5, false), "245");
+}
+
+TEST_F(Ametsuchi_Test, ArchiveTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+  std::vector<std::vector<uint8_t>> blobs;
+
+  auto append = [&](size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      blobs.push_back(generator::random_transaction(
+          fbb, iroha::Command::AccountAdd,
+          generator::random_AccountAdd(fbb, generator::random_account())
+              .Union()));
+      ametsuchi_.append(&blobs.back());
+    }
+  };
+
+  auto check = [&](bool uncommitted) {
+    for (size_t i = 0; i < blobs.size(); i++) {
+      auto tx = ametsuchi_.getTransaction(i + 1, uncommitted);
+      auto expected = flatbuffers::GetRoot<iroha::Transaction>(blobs[i].data());
+      ASSERT_EQ(tx->creatorPubKey()->str(), expected->creatorPubKey()->str());
+    }
+  };
+
+  append(200);
+  ametsuchi_.commit();
+
+  ASSERT_EQ(ametsuchi_.archive(150), 150);
+  check(false);
+  check(true);
+
+  // appended transactions must be committed first
+  append(10);
+  ASSERT_THROW(ametsuchi_.archive(1000),
+               ametsuchi::exception::InternalError);
+  ASSERT_EQ(ametsuchi_.height(true), 210);
+  ametsuchi_.commit();
+  ASSERT_EQ(ametsuchi_.archive(1000), 210);
+  check(false);
+
+  // new transactions follow archived ones
+  append(5);
+  ametsuchi_.commit();
+  check(false);
+  ASSERT_EQ(ametsuchi_.archive(150), 210);
+}
+
+TEST_F(Ametsuchi_Test, AttachmentTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+  auto data = generator::random_blob(2 * AMETSUCHI_ATTACHMENT_THRESHOLD);
+
+  // equal attachments are stored once
+  auto digest = ametsuchi_.putAttachment(data);
+  ASSERT_EQ(ametsuchi_.putAttachment(data), digest);
+  ASSERT_EQ(ametsuchi_.getAttachment(digest, true).size, data.size());
+
+  // transaction refers to the attachment by digest
+  std::vector<uint8_t> digestv(digest.begin(), digest.end());
+  auto blob = generator::random_transaction(
+      fbb, iroha::Command::AccountAdd,
+      generator::random_AccountAdd(fbb, generator::random_account()).Union(),
+      5, generator::random_public_key(),
+      generator::random_blob(generator::HASH_SIZE_BLOB_), 0,
+      iroha::CreateAttachmentDirect(fbb, "image/png", nullptr, &digestv));
+  ametsuchi_.append(&blob);
+  ametsuchi_.commit();
+
+  auto attachment = ametsuchi_.getTransaction(1)->attachment();
+  ASSERT_TRUE(attachment->data() == nullptr);
+  ASSERT_EQ(attachment->digest()->size(), digest.size());
+
+  auto stored = ametsuchi_.getAttachment(digest);
+  ASSERT_EQ(stored.size, data.size());
+  ASSERT_EQ(std::memcmp(stored.data, data.data(), data.size()), 0);
+
+  // attachment, which is not stored, is rejected
+  digestv[0] ^= 1;
+  blob = generator::random_transaction(
+      fbb, iroha::Command::AccountAdd,
+      generator::random_AccountAdd(fbb, generator::random_account()).Union(),
+      5, generator::random_public_key(),
+      generator::random_blob(generator::HASH_SIZE_BLOB_), 0,
+      iroha::CreateAttachmentDirect(fbb, "image/png", nullptr, &digestv));
+  ASSERT_THROW(ametsuchi_.append(&blob),
+               ametsuchi::exception::InvalidTransaction);
+}
+
+TEST_F(Ametsuchi_Test, SnapshotTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+  std::string snapshot = "/tmp/ametsuchi_snapshot/";
+  std::string installed = "/tmp/ametsuchi_installed/";
+
+  auto blob = generator::random_transaction(
+      fbb, iroha::Command::AssetCreate,
+      generator::random_AssetCreate(fbb, "Dollar", "USA", "l1").Union());
+  ametsuchi_.append(&blob);
+  blob = generator::random_transaction(
+      fbb, iroha::Command::AccountAdd,
+      generator::random_AccountAdd(fbb, generator::random_account("1"))
+          .Union());
+  ametsuchi_.append(&blob);
+  blob = generator::random_transaction(
+      fbb, iroha::Command::Add,
+      generator::random_Add(fbb, "1",
+                            generator::random_asset_wrapper_currency(
+                                345, 2, "Dollar", "USA", "l1"))
+          .Union());
+  ametsuchi_.append(&blob);
+  ametsuchi_.commit();
+
+  auto info = ametsuchi_.exportSnapshot(snapshot);
+  ASSERT_EQ(info.height, 3);
+  ASSERT_EQ(std::string(info.root.begin(), info.root.end()),
+            ametsuchi_.getMerkleRoot());
+
+  ametsuchi::Ametsuchi::installSnapshot(snapshot, installed);
+  {
+    ametsuchi::Ametsuchi db(installed);
+    ASSERT_EQ(db.height(), 3);
+    ASSERT_EQ(db.getMerkleRoot(), ametsuchi_.getMerkleRoot());
+
+    auto add = flatbuffers::GetRoot<iroha::Transaction>(blob.data())
+                   ->command_as_Add();
+    auto currency = add->asset_nested_root()->asset_as_Currency();
+    auto asset = db.accountGetAsset(add->accPubKey(), currency->ledger_name(),
+                                    currency->domain_name(),
+                                    currency->currency_name());
+    ASSERT_EQ(asset->asset_as_Currency()->amount()->str(), "345");
+
+    // installed database continues after snapshot height
+    blob = generator::random_transaction(
+        fbb, iroha::Command::AccountAdd,
+        generator::random_AccountAdd(fbb, generator::random_account("2"))
+            .Union());
+    db.append(&blob);
+    db.commit();
+    ASSERT_EQ(db.height(), 4);
+    ASSERT_EQ(db.getTransaction(4)->command_type(),
+              iroha::Command::AccountAdd);
+  }
+
+  system(("rm -rf " + installed).c_str());
+}
+
+TEST_F(Ametsuchi_Test, MerkleRootAtHeightTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+  std::vector<std::string> roots;
+  for (size_t i = 0; i < 5; i++) {
+    auto blob = generator::random_transaction(
+        fbb, iroha::Command::AccountAdd,
+        generator::random_AccountAdd(fbb, generator::random_account())
+            .Union());
+    auto root = ametsuchi_.append(&blob);
+    roots.emplace_back(root.begin(), root.end());
+  }
+  // roots are read for peers, only committed ones
+  ASSERT_EQ(ametsuchi_.getMerkleRoot(1), "");
+  ametsuchi_.commit();
+
+  for (size_t i = 0; i < roots.size(); i++) {
+    ASSERT_EQ(ametsuchi_.getMerkleRoot(i + 1), roots[i]);
+  }
+  ASSERT_EQ(ametsuchi_.getMerkleRoot(roots.size()),
+            ametsuchi_.getMerkleRoot());
+  ASSERT_NE(ametsuchi_.getMerkleRoot(1), ametsuchi_.getMerkleRoot(2));
+  ASSERT_EQ(ametsuchi_.getMerkleRoot(roots.size() + 1), "");
+}
+
+TEST_F(Ametsuchi_Test, ConsensusOrderTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+  std::string snapshot = "/tmp/ametsuchi_order_snapshot/";
+  std::string installed = "/tmp/ametsuchi_order_installed/";
+  ASSERT_EQ(ametsuchi_.order(), 0);
+
+  // order is committed with the transaction
+  auto blob = generator::random_transaction(
+      fbb, iroha::Command::AccountAdd,
+      generator::random_AccountAdd(fbb, generator::random_account()).Union());
+  ametsuchi_.append(&blob);
+  ametsuchi_.setOrder(1);
+  ASSERT_EQ(ametsuchi_.order(), 0);
+  ametsuchi_.commit();
+  ASSERT_EQ(ametsuchi_.order(), 1);
+
+  // aborted order has no transaction, it does not follow height
+  ametsuchi_.setOrder(2);
+  ametsuchi_.commit();
+  ASSERT_EQ(ametsuchi_.order(), 2);
+  ASSERT_EQ(ametsuchi_.height(), 1);
+
+  ametsuchi_.setOrder(3);
+  ametsuchi_.rollback();
+  ASSERT_EQ(ametsuchi_.order(), 2);
+
+  // order is a part of snapshot
+  ametsuchi_.exportSnapshot(snapshot);
+  ametsuchi::Ametsuchi::installSnapshot(snapshot, installed);
+  {
+    ametsuchi::Ametsuchi db(installed);
+    ASSERT_EQ(db.order(), 2);
+  }
+
+  system(("rm -rf " + installed).c_str());
+}
+
+TEST_F(Ametsuchi_Test, RejectedOrderTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+
+  // rejected transaction is rolled back, its order is still committed
+  auto blob = generator::random_transaction(
+      fbb, iroha::Command::Subtract,
+      generator::random_Subtract(fbb, "1",
+                                 generator::random_asset_wrapper_currency(
+                                     1, 2, "Dollar", "USA", "l1"))
+          .Union());
+  ASSERT_THROW(ametsuchi_.append(&blob),
+               ametsuchi::exception::InvalidTransaction);
+  ametsuchi_.rollback();
+  ametsuchi_.setOrder(1);
+  ametsuchi_.commit();
+  ASSERT_EQ(ametsuchi_.order(), 1);
+  ASSERT_EQ(ametsuchi_.height(), 0);
+
+  // next order is applied after it
+  blob = generator::random_transaction(
+      fbb, iroha::Command::AccountAdd,
+      generator::random_AccountAdd(fbb, generator::random_account()).Union());
+  ametsuchi_.append(&blob);
+  ametsuchi_.setOrder(2);
+  ametsuchi_.commit();
+  ASSERT_EQ(ametsuchi_.order(), 2);
+  ASSERT_EQ(ametsuchi_.height(), 1);
+}
+
 TEST_F(Ametsuchi_Test, PeerTest) {
   std::string ledger_name = "ShinkaiHideo";
   std::string pubkey1 = "SOULCATCHER_S";
@@ -302,13 +898,7 @@ TEST_F(Ametsuchi_Test, PeerTest) {
     fbb.Finish(tmp_pubkey);
     auto query_pubkey = flatbuffers::GetRoot<flatbuffers::String>(fbb.GetBufferPointer());
 
-    bool exception_flag = false;
-    try {
-      ametsuchi_.pubKeyGetPeer(query_pubkey, true);
-    } catch ( ... ) {
-      exception_flag = true;
-    }
-    ASSERT_TRUE( exception_flag );
+    ASSERT_EQ(ametsuchi_.pubKeyGetPeer(query_pubkey, true), nullptr);
   }
 
   {  // Remove peer2
@@ -325,15 +915,200 @@ TEST_F(Ametsuchi_Test, PeerTest) {
     fbb.Finish(tmp_pubkey);
     auto query_pubkey = flatbuffers::GetRoot<flatbuffers::String>(fbb.GetBufferPointer());
 
-    bool exception_flag = false;
-    try {
-      ametsuchi_.pubKeyGetPeer(query_pubkey, true);
-    } catch ( ... ) {
-      exception_flag = true;
+    ASSERT_EQ(ametsuchi_.pubKeyGetPeer(query_pubkey, true), nullptr);
+  }
+
+  ametsuchi_.commit();
+
+}
+class Ametsuchi_Sharded_Test : public ::testing::Test {
+ protected:
+  virtual void TearDown() { system(("rm -rf " + folder).c_str()); }
+
+  std::string folder = "/tmp/ametsuchi_sharded/";
+  ametsuchi::Ametsuchi ametsuchi_;
+
+  Ametsuchi_Sharded_Test() : ametsuchi_(folder, 4) {}
+};
+
+TEST_F(Ametsuchi_Sharded_Test, TransferBetweenShardsTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+
+  auto blob = generator::random_transaction(
+      fbb, iroha::Command::AssetCreate,
+      generator::random_AssetCreate(fbb, "Dollar", "USA", "l1").Union());
+  ametsuchi_.append(&blob);
+
+  // accounts are spread over shards by public key
+  std::vector<std::string> accounts{"1", "2", "3", "4", "5", "6", "7", "8"};
+  for (auto &&account : accounts) {
+    blob = generator::random_transaction(
+        fbb, iroha::Command::AccountAdd,
+        generator::random_AccountAdd(fbb, generator::random_account(account))
+            .Union());
+    ametsuchi_.append(&blob);
+  }
+
+  blob = generator::random_transaction(
+      fbb, iroha::Command::Add,
+      generator::random_Add(fbb, "1",
+                            generator::random_asset_wrapper_currency(
+                                800, 2, "Dollar", "USA", "l1"))
+          .Union());
+  ametsuchi_.append(&blob);
+
+  // 1 -> 2 -> ... -> 8, 100 each
+  for (size_t i = 0; i + 1 < accounts.size(); i++) {
+    blob = generator::random_transaction(
+        fbb, iroha::Command::Transfer,
+        generator::random_Transfer(fbb,
+                                   generator::random_asset_wrapper_currency(
+                                       100 * (accounts.size() - i - 1), 2,
+                                       "Dollar", "USA", "l1"),
+                                   accounts[i], accounts[i + 1])
+            .Union());
+    ametsuchi_.append(&blob);
+  }
+
+  auto check = [this](bool uncommitted) {
+    flatbuffers::FlatBufferBuilder fbb2(2048);
+    auto reference_tx =
+        flatbuffers::GetRoot<iroha::Transaction>(
+            generator::random_transaction(
+                fbb2, iroha::Command::Transfer,
+                generator::random_Transfer(
+                    fbb2, generator::random_asset_wrapper_currency(
+                              100, 2, "Dollar", "USA", "l1"),
+                    "1", "8")
+                    .Union())
+                .data())
+            ->command_as_Transfer();
+    auto currency = reference_tx->asset_nested_root()->asset_as_Currency();
+
+    auto asset1 = ametsuchi_.accountGetAsset(
+        reference_tx->sender(), currency->ledger_name(),
+        currency->domain_name(), currency->currency_name(), uncommitted);
+    ASSERT_EQ(asset1->asset_as_Currency()->amount()->str(), "100");
+
+    auto asset8 = ametsuchi_.accountGetAsset(
+        reference_tx->receiver(), currency->ledger_name(),
+        currency->domain_name(), currency->currency_name(), uncommitted);
+    ASSERT_EQ(asset8->asset_as_Currency()->amount()->str(), "100");
+  };
+
+  check(true);
+  ametsuchi_.commit();
+  check(false);
+
+  // overdrawn transfer fails in the sender's shard, receiver's shard does
+  // not credit it
+  for (size_t i = 1; i < accounts.size(); i++) {
+    blob = generator::random_transaction(
+        fbb, iroha::Command::Transfer,
+        generator::random_Transfer(fbb,
+                                   generator::random_asset_wrapper_currency(
+                                       500, 2, "Dollar", "USA", "l1"),
+                                   accounts[0], accounts[i])
+            .Union());
+    ASSERT_THROW(ametsuchi_.append(&blob),
+                 ametsuchi::exception::InvalidTransaction);
+
+    auto transfer = flatbuffers::GetRoot<iroha::Transaction>(blob.data())
+                        ->command_as_Transfer();
+    auto currency = transfer->asset_nested_root()->asset_as_Currency();
+    for (auto account : {transfer->sender(), transfer->receiver()}) {
+      auto asset = ametsuchi_.accountGetAsset(
+          account, currency->ledger_name(), currency->domain_name(),
+          currency->currency_name(), true);
+      ASSERT_EQ(asset->asset_as_Currency()->amount()->str(), "100");
     }
-    ASSERT_TRUE( exception_flag );
+    ametsuchi_.rollback();
   }
+  check(false);
+}
 
+class Ametsuchi_Compression_Test : public ::testing::Test {
+ protected:
+  virtual void TearDown() { system(("rm -rf " + folder).c_str()); }
+
+  std::string folder = "/tmp/ametsuchi_compressed/";
+  ametsuchi::Ametsuchi ametsuchi_;
+
+  Ametsuchi_Compression_Test() : ametsuchi_(folder, 1, 3) {}
+};
+
+TEST_F(Ametsuchi_Compression_Test, ReadCompressedTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+  std::vector<std::vector<uint8_t>> blobs;
+
+  // samples are stored as is, dictionary is trained on commit
+  for (size_t i = 0; i < AMETSUCHI_TX_DICT_SAMPLES; i++) {
+    blobs.push_back(generator::random_transaction(
+        fbb, iroha::Command::AccountAdd,
+        generator::random_AccountAdd(fbb, generator::random_account())
+            .Union()));
+    ametsuchi_.append(&blobs.back());
+  }
   ametsuchi_.commit();
 
-}
\ No newline at end of file
+  for (size_t i = 0; i < 100; i++) {
+    blobs.push_back(generator::random_transaction(
+        fbb, iroha::Command::AccountAdd,
+        generator::random_AccountAdd(fbb, generator::random_account())
+            .Union()));
+    ametsuchi_.append(&blobs.back());
+  }
+
+  auto check = [&](size_t index, bool uncommitted) {
+    auto tx = ametsuchi_.getTransaction(index + 1, uncommitted);
+    auto expected =
+        flatbuffers::GetRoot<iroha::Transaction>(blobs[index].data());
+    ASSERT_EQ(tx->command_type(), iroha::Command::AccountAdd);
+    ASSERT_EQ(tx->creatorPubKey()->str(), expected->creatorPubKey()->str());
+    ASSERT_TRUE(std::equal(tx->hash()->begin(), tx->hash()->end(),
+                           expected->hash()->begin()));
+  };
+
+  for (size_t i = 0; i < blobs.size(); i++) {
+    check(i, true);
+  }
+  ametsuchi_.commit();
+  for (size_t i = 0; i < blobs.size(); i++) {
+    check(i, false);
+  }
+}
+
+TEST_F(Ametsuchi_Compression_Test, QueryMoreThanCacheTest) {
+  flatbuffers::FlatBufferBuilder fbb(2048);
+
+  for (size_t i = 0; i < AMETSUCHI_TX_DICT_SAMPLES; i++) {
+    auto blob = generator::random_transaction(
+        fbb, iroha::Command::AccountAdd,
+        generator::random_AccountAdd(fbb, generator::random_account())
+            .Union());
+    ametsuchi_.append(&blob);
+  }
+  ametsuchi_.commit();
+
+  // every result of one query must stay valid, while the query evicts
+  // earlier results from the cache of decompressed transactions
+  std::vector<std::vector<uint8_t>> blobs;
+  for (size_t i = 0; i < AMETSUCHI_TX_CACHE_SIZE + 100; i++) {
+    blobs.push_back(generator::random_transaction(
+        fbb, iroha::Command::AccountAdd,
+        generator::random_AccountAdd(fbb, generator::random_account())
+            .Union(),
+        5, generator::random_public_key(), generator::random_blob(32),
+        1000));
+    ametsuchi_.append(&blobs.back());
+  }
+  ametsuchi_.commit();
+
+  auto txs = ametsuchi_.getTransactionsByTime(1000, 1000);
+  ASSERT_EQ(txs.size(), blobs.size());
+  for (size_t i = 0; i < txs.size(); i++) {
+    auto tx = flatbuffers::GetRoot<iroha::Transaction>(txs[i].data);
+    auto expected = flatbuffers::GetRoot<iroha::Transaction>(blobs[i].data());
+    ASSERT_EQ(tx->creatorPubKey()->str(), expected->creatorPubKey()->str());
+  }
+}
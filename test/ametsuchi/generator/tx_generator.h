@@ -291,20 +291,24 @@ flatbuffers::Offset<iroha::PeerRemove> random_PeerRemove(
  * @param signatures - number of signatures
  * @param creator - random public key of a creator
  * @param hash - random hash of a transaction
+ * @param timestamp - timestamp of a transaction
  * @return ready to be transmitted/parsed root Transaction flatbuffer
  */
 std::vector<uint8_t> random_transaction(
     flatbuffers::FlatBufferBuilder& fbb, iroha::Command cmd_type,
     flatbuffers::Offset<void> command, const size_t signatures = 5,
     std::string creator = random_public_key(),
-    std::vector<uint8_t> hash = random_blob(HASH_SIZE_BLOB_)) {
+    std::vector<uint8_t> hash = random_blob(HASH_SIZE_BLOB_),
+    uint64_t timestamp = 0,
+    flatbuffers::Offset<iroha::Attachment> attachment = 0) {
   std::vector<flatbuffers::Offset<iroha::Signature>> sigs(signatures);
   std::generate_n(sigs.begin(), signatures,
                   [&fbb]() { return random_signature(fbb); });
 
   auto tx = iroha::CreateTransaction(fbb, fbb.CreateString(creator), cmd_type,
                                      command, fbb.CreateVector(sigs),
-                                     fbb.CreateVector(hash));
+                                     fbb.CreateVector(hash), timestamp,
+                                     attachment);
 
   fbb.Finish(tx);
 
@@ -96,6 +96,7 @@ class connection_with_grpc_flatbuffer_test : public testing::Test {
           ASSERT_EQ(transaction.peer().address(), toriiPeerAddress);
           ASSERT_TRUE(transaction.peer().trust().value() == 1.0);
            */
+          return ::iroha::Code::UNDECIDED;
         });
     connection::run();
   }
@@ -0,0 +1,77 @@
+/**
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <consensus/mempool.hpp>
+#include <string>
+#include <vector>
+
+using Admission = sumeragi::Mempool::Admission;
+
+static std::vector<std::uint8_t> blob(size_t size, std::uint8_t tag) {
+  return std::vector<std::uint8_t>(size, tag);
+}
+
+TEST(MempoolTest, Deduplicate) {
+  sumeragi::Mempool mempool(10, 1000, 10);
+  ASSERT_EQ(mempool.add("h1", "alice", blob(10, 1)), Admission::ACCEPTED);
+  ASSERT_EQ(mempool.add("h1", "alice", blob(10, 1)), Admission::DUPLICATE);
+
+  std::vector<std::uint8_t> tx;
+  ASSERT_TRUE(mempool.pop(tx));
+  ASSERT_EQ(tx, blob(10, 1));
+  ASSERT_FALSE(mempool.pop(tx));
+
+  auto stats = mempool.stats();
+  ASSERT_EQ(stats.size, 0u);
+  ASSERT_EQ(stats.bytes, 0u);
+  ASSERT_EQ(stats.accepted, 1u);
+  ASSERT_EQ(stats.duplicates, 1u);
+}
+
+TEST(MempoolTest, BusyWhenFull) {
+  sumeragi::Mempool mempool(2, 25, 10);
+  ASSERT_EQ(mempool.add("h1", "alice", blob(10, 1)), Admission::ACCEPTED);
+  // bytes
+  ASSERT_EQ(mempool.add("h2", "bob", blob(20, 2)), Admission::BUSY);
+  ASSERT_EQ(mempool.add("h2", "bob", blob(10, 2)), Admission::ACCEPTED);
+  // count
+  ASSERT_EQ(mempool.add("h3", "carol", blob(1, 3)), Admission::BUSY);
+  ASSERT_EQ(mempool.stats().rejected, 2u);
+
+  std::vector<std::uint8_t> tx;
+  ASSERT_TRUE(mempool.pop(tx));
+  ASSERT_EQ(mempool.add("h3", "carol", blob(1, 3)), Admission::ACCEPTED);
+}
+
+TEST(MempoolTest, CreatorsTakeTurns) {
+  sumeragi::Mempool mempool(100, 1000, 3);
+  for (std::uint8_t i = 0; i < 3; i++) {
+    ASSERT_EQ(mempool.add("a" + std::to_string(i), "alice", blob(1, i)),
+              Admission::ACCEPTED);
+  }
+  // one creator may not take the whole mempool
+  ASSERT_EQ(mempool.add("a3", "alice", blob(1, 3)), Admission::BUSY);
+  ASSERT_EQ(mempool.add("b0", "bob", blob(1, 10)), Admission::ACCEPTED);
+
+  std::vector<std::uint8_t> order;
+  std::vector<std::uint8_t> tx;
+  while (mempool.pop(tx)) {
+    order.push_back(tx[0]);
+  }
+  ASSERT_EQ(order, (std::vector<std::uint8_t>{0, 10, 1, 2}));
+}
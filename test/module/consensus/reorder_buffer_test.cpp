@@ -0,0 +1,113 @@
+/**
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <consensus/reorder_buffer.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// event is a buffer with its name, content is not looked at by the buffer
+flatbuffers::unique_ptr_t event(const std::string& name) {
+  flatbuffers::FlatBufferBuilder fbb;
+  fbb.Finish(fbb.CreateString(name));
+  return fbb.ReleaseBufferPointer();
+}
+
+std::string name(const sumeragi::ReorderBuffer::Event& e) {
+  return flatbuffers::GetRoot<flatbuffers::String>(e->get())->str();
+}
+
+}  // namespace
+
+TEST(ReorderBufferTest, AppliesByOrder) {
+  sumeragi::ReorderBuffer commits(1, 8);
+  std::vector<std::string> applied;
+  auto apply = [&](std::uint64_t, const sumeragi::ReorderBuffer::Event& e) {
+    applied.push_back(name(e));
+  };
+
+  ASSERT_TRUE(commits.push(3, event("c")));
+  ASSERT_TRUE(commits.push(2, event("b")));
+  ASSERT_EQ(commits.drain(apply), 0u);
+  ASSERT_FALSE(commits.empty());
+
+  ASSERT_TRUE(commits.push(1, event("a")));
+  ASSERT_EQ(commits.drain(apply), 3u);
+  ASSERT_EQ(applied, (std::vector<std::string>{"a", "b", "c"}));
+  ASSERT_EQ(commits.next(), 4u);
+  ASSERT_TRUE(commits.empty());
+
+  // applied order is not taken again
+  ASSERT_FALSE(commits.push(2, event("b")));
+  ASSERT_EQ(name(commits.decided(2)), "b");
+  ASSERT_EQ(commits.decided(4), nullptr);
+}
+
+TEST(ReorderBufferTest, FailedApplyKeepsOrder) {
+  sumeragi::ReorderBuffer commits(5, 8);
+  std::vector<std::uint64_t> applied;
+  bool fail = true;
+  auto apply = [&](std::uint64_t order, const sumeragi::ReorderBuffer::Event&) {
+    if (order == 6 && fail) throw std::runtime_error("ledger fault");
+    applied.push_back(order);
+  };
+
+  commits.push(7, event("c"));
+  commits.push(6, event("b"));
+  commits.push(5, event("a"));
+  ASSERT_THROW(commits.drain(apply), std::runtime_error);
+  // failed event is not lost and later ones wait for it
+  ASSERT_EQ(applied, (std::vector<std::uint64_t>{5}));
+  ASSERT_EQ(commits.next(), 6u);
+  ASSERT_FALSE(commits.empty());
+  ASSERT_EQ(commits.decided(6), nullptr);
+
+  // a copy of the held order does not replace it, next drain applies it
+  ASSERT_FALSE(commits.push(6, event("copy")));
+  fail = false;
+  std::vector<std::string> names;
+  ASSERT_EQ(commits.drain([&](std::uint64_t order,
+                              const sumeragi::ReorderBuffer::Event& e) {
+              apply(order, e);
+              names.push_back(name(e));
+            }),
+            2u);
+  ASSERT_EQ(names, (std::vector<std::string>{"b", "c"}));
+  ASSERT_EQ(applied, (std::vector<std::uint64_t>{5, 6, 7}));
+  ASSERT_EQ(commits.next(), 8u);
+}
+
+TEST(ReorderBufferTest, KeepsHistory) {
+  sumeragi::ReorderBuffer commits(1, 2);
+  for (std::uint64_t order = 1; order <= 4; order++) {
+    commits.push(order, event(std::to_string(order)));
+  }
+  commits.drain([](std::uint64_t, const sumeragi::ReorderBuffer::Event&) {});
+
+  ASSERT_EQ(commits.decided(1), nullptr);
+  ASSERT_EQ(commits.decided(2), nullptr);
+  ASSERT_EQ(name(commits.decided(3)), "3");
+  ASSERT_EQ(name(commits.decided(4)), "4");
+
+  commits.reset(10, 2);
+  ASSERT_EQ(commits.next(), 10u);
+  ASSERT_EQ(commits.decided(4), nullptr);
+  ASSERT_FALSE(commits.push(9, event("9")));
+}
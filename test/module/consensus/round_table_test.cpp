@@ -0,0 +1,86 @@
+/**
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <consensus/round_table.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(RoundTableTest, UpdateAndErase) {
+  sumeragi::RoundTable rounds(4);
+
+  auto signers = rounds.update("a", [](sumeragi::RoundState& r) {
+    r.signers.insert("peer1");
+    return r.signers.size();
+  });
+  ASSERT_EQ(signers, 1u);
+  signers = rounds.update("a", [](sumeragi::RoundState& r) {
+    r.signers.insert("peer2");
+    r.signers.insert("peer1");
+    return r.signers.size();
+  });
+  ASSERT_EQ(signers, 2u);
+  ASSERT_EQ(rounds.size(), 1u);
+
+  sumeragi::RoundState state;
+  ASSERT_TRUE(rounds.erase("a", &state));
+  ASSERT_EQ(state.signers.size(), 2u);
+  ASSERT_EQ(state.phase, sumeragi::RoundPhase::SIGNING);
+  ASSERT_FALSE(rounds.erase("a"));
+  ASSERT_EQ(rounds.size(), 0u);
+}
+
+TEST(RoundTableTest, VisitDoesNotCreate) {
+  sumeragi::RoundTable rounds;
+  ASSERT_FALSE(rounds.visit("a", [](sumeragi::RoundState& r) {
+    r.scheduled = true;
+  }));
+  ASSERT_EQ(rounds.size(), 0u);
+
+  rounds.update("a", [](sumeragi::RoundState&) {});
+  ASSERT_TRUE(rounds.visit("a", [](sumeragi::RoundState& r) {
+    r.scheduled = true;
+  }));
+  ASSERT_TRUE(rounds.update("a", [](sumeragi::RoundState& r) {
+    return r.scheduled;
+  }));
+}
+
+TEST(RoundTableTest, ParallelRounds) {
+  sumeragi::RoundTable rounds;
+  const int threads = 8, keys = 100;
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&rounds, t] {
+      for (int k = 0; k < keys; k++) {
+        rounds.update(std::to_string(k), [t](sumeragi::RoundState& r) {
+          r.signers.insert(std::to_string(t));
+        });
+      }
+    });
+  }
+  for (auto&& w : workers) w.join();
+
+  ASSERT_EQ(rounds.size(), static_cast<size_t>(keys));
+  for (int k = 0; k < keys; k++) {
+    auto signers = rounds.update(std::to_string(k),
+                                 [](sumeragi::RoundState& r) { return r.signers.size(); });
+    ASSERT_EQ(signers, static_cast<size_t>(threads));
+  }
+}
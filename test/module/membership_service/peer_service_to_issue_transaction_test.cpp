@@ -78,6 +78,7 @@ class peer_service_to_issue_transaction_test : public ::testing::Test {
       ASSERT_EQ(transaction.peer().address(), toriiPeerAddress);
       ASSERT_TRUE(transaction.peer().trust().value() == 1.0);
        */
+      return ::iroha::Code::UNDECIDED;
     });
     connection::run();
   }
@@ -0,0 +1,37 @@
+/**
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <membership_service/synchronizer.hpp>
+
+using peer::sync::detail::firstFetchIndex;
+
+TEST(SynchronizerTest, EmptyLedgerFetchesFromStart) {
+  ASSERT_EQ(firstFetchIndex(0, false), 1);
+  ASSERT_EQ(firstFetchIndex(0, true), 1);
+}
+
+TEST(SynchronizerTest, PrefixFetchesSuffix) {
+  // roots agree at own height 10, leader has it and maybe more
+  ASSERT_EQ(firstFetchIndex(10, true), 11);
+}
+
+TEST(SynchronizerTest, DivergedTailIsNotAppendedTo) {
+  // roots differ at own height: some of transactions 1..10 differ from the
+  // leader's ones, appending after them would never converge
+  ASSERT_EQ(firstFetchIndex(10, false), 0);
+}
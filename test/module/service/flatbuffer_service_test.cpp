@@ -327,6 +327,99 @@ TEST(FlatbufferServiceTest, makeCommit_AccountAdd) {
   ASSERT_EQ(txptrFromEvent->attachment()->data()->size(), 3);
 }
 
+/***************************************************************************************
+ * mergeSignatures
+ ***************************************************************************************/
+TEST(FlatbufferServiceTest, mergeSignatures_AccountAdd) {
+  flatbuffers::FlatBufferBuilder fbb;
+
+  const auto accountBuf = flatbuffer_service::account::CreateAccount(
+    "PublicKey", "Alias", "PrevPubKey", {"sig1"}, 1);
+
+  std::vector<flatbuffers::Offset<::iroha::Signature>> signatureOffsets;
+  const auto _hash = std::vector<uint8_t>{'h'};
+
+  const auto txOffset = ::iroha::CreateTransactionDirect(
+    fbb, "Creator PubKey", iroha::Command::AccountAdd,
+    ::iroha::CreateAccountAddDirect(fbb, &accountBuf).Union(),
+    &signatureOffsets, &_hash, datetime::unixtime());
+
+  fbb.Finish(txOffset);
+
+  const auto ptr = fbb.ReleaseBufferPointer();
+  const auto txptr = flatbuffers::GetRoot<::iroha::Transaction>(ptr.get());
+
+  auto consensusEvent = flatbuffer_service::toConsensusEvent(*txptr, 7);
+  ASSERT_TRUE(consensusEvent);
+
+  flatbuffers::unique_ptr_t uptr;
+  consensusEvent.move_value(uptr);
+  auto root = flatbuffers::GetRoot<::iroha::ConsensusEvent>(uptr.get());
+
+  // two copies of the event, signed by peer 1 and 2, and by peer 1 and 3
+  auto copy1 = flatbuffer_service::addSignature(*root, "PEER 1", "SIG 1");
+  auto copy2 = flatbuffer_service::addSignature(*root, "PEER 1", "SIG 1");
+  ASSERT_TRUE(copy1 && copy2);
+  copy1 = flatbuffer_service::addSignature(
+    *flatbuffers::GetRoot<::iroha::ConsensusEvent>(copy1.value().get()),
+    "PEER 2", "SIG 2");
+  copy2 = flatbuffer_service::addSignature(
+    *flatbuffers::GetRoot<::iroha::ConsensusEvent>(copy2.value().get()),
+    "PEER 3", "SIG 3");
+  ASSERT_TRUE(copy1 && copy2);
+
+  auto merged = flatbuffer_service::mergeSignatures(
+    *flatbuffers::GetRoot<::iroha::ConsensusEvent>(copy1.value().get()),
+    *flatbuffers::GetRoot<::iroha::ConsensusEvent>(copy2.value().get()));
+  ASSERT_TRUE(merged);
+
+  merged.move_value(uptr);
+  root = flatbuffers::GetRoot<::iroha::ConsensusEvent>(uptr.get());
+
+  ASSERT_EQ(root->peerSignatures()->size(), 3);
+  ASSERT_STREQ(root->peerSignatures()->Get(0)->publicKey()->c_str(), "PEER 1");
+  ASSERT_STREQ(root->peerSignatures()->Get(1)->publicKey()->c_str(), "PEER 2");
+  ASSERT_STREQ(root->peerSignatures()->Get(2)->publicKey()->c_str(), "PEER 3");
+  ASSERT_EQ(root->code(), ::iroha::Code::UNDECIDED);
+  ASSERT_EQ(root->order(), 7);
+  ASSERT_STREQ(root->transactions()
+                 ->Get(0)
+                 ->tx_nested_root()
+                 ->creatorPubKey()
+                 ->c_str(),
+               "Creator PubKey");
+}
+
+/***************************************************************************************
+ * makeAbort
+ ***************************************************************************************/
+TEST(FlatbufferServiceTest, makeAbort) {
+  auto abort = flatbuffer_service::makeAbort(7);
+  ASSERT_TRUE(abort);
+
+  flatbuffers::unique_ptr_t uptr;
+  abort.move_value(uptr);
+  auto root = flatbuffers::GetRoot<::iroha::ConsensusEvent>(uptr.get());
+  ASSERT_EQ(root->transactions()->size(), 0);
+  ASSERT_EQ(root->code(), ::iroha::Code::UNDECIDED);
+  ASSERT_EQ(root->order(), 7);
+
+  // abort is signed and committed like any event
+  auto signedAbort = flatbuffer_service::addSignature(*root, "PEER 1", "SIG 1");
+  ASSERT_TRUE(signedAbort);
+  root = flatbuffers::GetRoot<::iroha::ConsensusEvent>(signedAbort.value().get());
+  ASSERT_EQ(root->peerSignatures()->size(), 1);
+  ASSERT_EQ(root->transactions()->size(), 0);
+
+  auto committed = flatbuffer_service::makeCommit(*root);
+  ASSERT_TRUE(committed);
+  root = flatbuffers::GetRoot<::iroha::ConsensusEvent>(committed.value().get());
+  ASSERT_EQ(root->code(), ::iroha::Code::COMMIT);
+  ASSERT_EQ(root->order(), 7);
+  ASSERT_EQ(root->peerSignatures()->size(), 1);
+  ASSERT_EQ(root->transactions()->size(), 0);
+}
+
 /***************************************************************************************
  * copyConsensusEvent
  ***************************************************************************************/
@@ -64,3 +64,14 @@ TEST(CacheMapTest, CacheMapTest) {
     ASSERT_TRUE(cmap[is[i]] == vs[i]);
   }
 }
+
+TEST(CacheMapTest, SetEvictsOldest) {
+  structure::CacheMap<int, std::string> cmap(3);
+  for (int i = 1; i <= 5; i++) {
+    ASSERT_EQ(cmap.set(i, std::to_string(i)), std::min<size_t>(i, 3));
+  }
+  ASSERT_TRUE(cmap.count(1) == 0);
+  ASSERT_TRUE(cmap.count(2) == 0);
+  ASSERT_TRUE(cmap[5] == "5");
+  ASSERT_TRUE(cmap.getMaxKey() == 5);
+}
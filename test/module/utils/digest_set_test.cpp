@@ -0,0 +1,87 @@
+/**
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <utils/digest_set.hpp>
+#include <random>
+#include <thread>
+#include <vector>
+
+using structure::DigestSet;
+
+static std::vector<DigestSet::Key> makeKeys(size_t n) {
+  std::mt19937_64 gen(42);
+  std::vector<DigestSet::Key> keys(n);
+  for (auto&& key : keys) {
+    for (auto&& byte : key) byte = static_cast<std::uint8_t>(gen());
+  }
+  return keys;
+}
+
+TEST(DigestSetTest, InsertOnce) {
+  DigestSet set(128, 4);
+  auto keys = makeKeys(100);
+  for (auto&& key : keys) {
+    ASSERT_TRUE(set.insert(key));
+  }
+  for (auto&& key : keys) {
+    ASSERT_TRUE(set.contains(key));
+    ASSERT_FALSE(set.insert(key));
+  }
+  ASSERT_EQ(set.size(), 100u);
+}
+
+TEST(DigestSetTest, OldEpochsAreForgotten) {
+  DigestSet set(64, 1);
+  auto keys = makeKeys(1000);
+  for (auto&& key : keys) {
+    set.insert(key);
+  }
+  // bounded, and the latest keys are remembered
+  ASSERT_LE(set.size(), 128u);
+  for (size_t i = keys.size() - 64; i < keys.size(); i++) {
+    ASSERT_TRUE(set.contains(keys[i]));
+  }
+  ASSERT_FALSE(set.contains(keys.front()));
+}
+
+TEST(DigestSetTest, ConcurrentInsertOnce) {
+  DigestSet set(4096);
+  auto keys = makeKeys(1000);
+  std::vector<size_t> inserted(4, 0);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < inserted.size(); t++) {
+    threads.emplace_back([&, t] {
+      for (auto&& key : keys) {
+        if (set.insert(key)) inserted[t]++;
+      }
+    });
+  }
+  for (auto&& thread : threads) thread.join();
+
+  size_t total = 0;
+  for (auto n : inserted) total += n;
+  ASSERT_EQ(total, keys.size());
+}
+
+TEST(DigestSetTest, FromHex) {
+  auto key = DigestSet::fromHex(std::string(62, '0') + "aF");
+  ASSERT_EQ(key[31], 0xaf);
+  ASSERT_EQ(key[0], 0);
+  ASSERT_THROW(DigestSet::fromHex("00"), std::invalid_argument);
+  ASSERT_THROW(DigestSet::fromHex(std::string(64, 'g')), std::invalid_argument);
+}
@@ -0,0 +1,48 @@
+/**
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <utils/latency_tracker.hpp>
+
+using micros = timer::LatencyTracker::duration;
+
+TEST(LatencyTrackerTest, Percentiles) {
+  timer::LatencyTracker tracker;
+  ASSERT_EQ(tracker.percentile("a", 99), micros::zero());
+
+  for (int i = 100; i >= 1; i--) {
+    tracker.record("a", micros(i));
+  }
+  tracker.record("b", micros(1000));
+
+  ASSERT_EQ(tracker.count("a"), 100u);
+  ASSERT_EQ(tracker.percentile("a", 50), micros(50));
+  ASSERT_EQ(tracker.percentile("a", 99), micros(99));
+  ASSERT_EQ(tracker.percentile("a", 100), micros(100));
+  ASSERT_EQ(tracker.percentile("a", 0), micros(1));
+  // every key
+  ASSERT_EQ(tracker.percentile(100), micros(1000));
+}
+
+TEST(LatencyTrackerTest, OnlyWindowIsKept) {
+  timer::LatencyTracker tracker(10);
+  for (int i = 1; i <= 100; i++) {
+    tracker.record("a", micros(i));
+  }
+  ASSERT_EQ(tracker.count("a"), 10u);
+  ASSERT_EQ(tracker.percentile("a", 0), micros(91));
+}
@@ -0,0 +1,51 @@
+/**
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <utils/priority_task_queue.hpp>
+#include <string>
+
+TEST(PriorityTaskQueueTest, UrgentFirst) {
+  structure::PriorityTaskQueue queue(3);
+  std::string ran;
+  queue.push(2, [&] { ran += "new1 "; });
+  queue.push(1, [&] { ran += "ordered "; });
+  queue.push(2, [&] { ran += "new2 "; });
+  queue.push(0, [&] { ran += "commit "; });
+  ASSERT_EQ(queue.size(2), 2u);
+
+  while (queue.run_one()) {
+  }
+  ASSERT_EQ(ran, "commit ordered new1 new2 ");
+  ASSERT_FALSE(queue.run_one());
+}
+
+TEST(PriorityTaskQueueTest, TaskMayPush) {
+  structure::PriorityTaskQueue queue(2);
+  std::string ran;
+  queue.push(1, [&] {
+    ran += "a ";
+    queue.push(0, [&] { ran += "b "; });
+  });
+  queue.push(1, [&] { ran += "c "; });
+  // level is clamped to the least urgent one
+  queue.push(5, [&] { ran += "d "; });
+
+  while (queue.run_one()) {
+  }
+  ASSERT_EQ(ran, "a b c d ");
+}
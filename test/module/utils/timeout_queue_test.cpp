@@ -0,0 +1,70 @@
+/**
+ * Copyright Soramitsu Co., Ltd. 2017 All Rights Reserved.
+ * http://soramitsu.co.jp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utils/timeout_queue.hpp>
+
+using namespace std::chrono;
+
+TEST(TimeoutQueueTest, FiresInDeadlineOrder) {
+  timer::TimeoutQueue queue;
+  std::mutex mutex;
+  std::vector<std::string> fired;
+  auto action = [&](const std::string& key) {
+    return [&, key] {
+      std::lock_guard<std::mutex> lock(mutex);
+      fired.push_back(key);
+    };
+  };
+
+  auto start = steady_clock::now();
+  queue.set("b", milliseconds(60), action("b"));
+  queue.set("a", milliseconds(20), action("a"));
+  // set() does not block the caller
+  ASSERT_LT(steady_clock::now() - start, milliseconds(20));
+  ASSERT_EQ(queue.size(), 2);
+
+  std::this_thread::sleep_for(milliseconds(200));
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_EQ(fired, std::vector<std::string>({"a", "b"}));
+  ASSERT_EQ(queue.size(), 0);
+}
+
+TEST(TimeoutQueueTest, CancelAndReplace) {
+  timer::TimeoutQueue queue;
+  std::atomic<int> cancelled{0}, replaced{0};
+
+  queue.set("cancelled", milliseconds(30), [&] { cancelled++; });
+  ASSERT_TRUE(queue.cancel("cancelled"));
+  ASSERT_FALSE(queue.cancel("cancelled"));
+
+  // the second timeout with the same key replaces the first one
+  queue.set("replaced", milliseconds(30), [&] { replaced += 1; });
+  queue.set("replaced", milliseconds(30), [&] { replaced += 10; });
+  ASSERT_EQ(queue.size(), 1);
+
+  std::this_thread::sleep_for(milliseconds(150));
+  ASSERT_EQ(cancelled, 0);
+  ASSERT_EQ(replaced, 10);
+  ASSERT_FALSE(queue.cancel("replaced"));
+}